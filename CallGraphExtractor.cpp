@@ -4,55 +4,150 @@
 #include "clang/Frontend/FrontendActions.h"
 #include "clang/AST/RecursiveASTVisitor.h"
 #include "clang/ASTMatchers/ASTMatchFinder.h"
+#include "clang/Index/USRGeneration.h"
+#include "clang/Lex/PPCallbacks.h"
+#include "clang/Lex/Preprocessor.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/VirtualFileSystem.h"
+#include "llvm/Support/xxhash.h"
 #include <set>
 #include <map>
 #include <iostream>
+#include <fstream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+#include "callgraph_store.hpp"
 
 using namespace clang;
 using namespace clang::tooling;
 using namespace clang::ast_matchers;
 
-std::map<std::string, std::set<std::string>> callGraph;
+static llvm::cl::OptionCategory ToolCategory("call-graph options");
+
+static llvm::cl::opt<unsigned> Jobs(
+    "j", llvm::cl::desc("Number of translation units to analyse in parallel (0 = one per core)"),
+    llvm::cl::init(0), llvm::cl::cat(ToolCategory));
+
+static llvm::cl::opt<bool> Timing(
+    "timing", llvm::cl::desc("Print the analysis time of each translation unit to stderr"),
+    llvm::cl::init(true), llvm::cl::cat(ToolCategory));
+
+static llvm::cl::opt<bool> SystemHeaders(
+    "system-headers", llvm::cl::desc("Keep functions declared in system headers (libstdc++ internals etc.)"),
+    llvm::cl::init(false), llvm::cl::cat(ToolCategory));
+
+static llvm::cl::opt<std::string> OutputFile(
+    "o", llvm::cl::desc("Write the merged graph in the binary call-graph format"),
+    llvm::cl::value_desc("file"), llvm::cl::cat(ToolCategory));
 
+static llvm::cl::opt<std::string> InputFile(
+    "i", llvm::cl::desc("Print a graph written earlier with -o instead of analysing sources"),
+    llvm::cl::value_desc("file"), llvm::cl::cat(ToolCategory));
+
+static llvm::cl::opt<std::string> CacheDir(
+    "cache-dir", llvm::cl::desc("Reuse per-TU graphs of unchanged translation units from this directory"),
+    llvm::cl::value_desc("dir"), llvm::cl::cat(ToolCategory));
+
+enum class OutputFormat { Text, Dot, None };
+
+static llvm::cl::opt<OutputFormat> Format(
+    "format", llvm::cl::desc("Graph printed to stdout"),
+    llvm::cl::values(clEnumValN(OutputFormat::Text, "text", "caller -> callee lines (default)"),
+                     clEnumValN(OutputFormat::Dot, "dot", "Graphviz"),
+                     clEnumValN(OutputFormat::None, "none", "nothing; use with -o")),
+    llvm::cl::init(OutputFormat::Text), llvm::cl::cat(ToolCategory));
+
+// Nodes are keyed by USR, so overloads and same-named methods of different classes stay
+// separate; the qualified name is kept for display.
 class FunctionCallGraphVisitor : public RecursiveASTVisitor<FunctionCallGraphVisitor> {
-public:
-    explicit FunctionCallGraphVisitor(ASTContext *Context) : Context(Context) {}
+    using Base = RecursiveASTVisitor<FunctionCallGraphVisitor>;
 
-    bool VisitFunctionDecl(FunctionDecl *Func) {
-        if (!Func->hasBody()) return true;
+public:
+    FunctionCallGraphVisitor(ASTContext *Context, CallGraphStore &Graph) : Context(Context), Graph(Graph) {}
 
-        currentFunc = Func->getNameAsString();
+    // Calls in a function body are attributed to it. currentFunc is restored afterwards, so
+    // whatever follows a nested definition (a local class's method, a default member
+    // initializer after an inline method) is not charged to that definition.
+    bool TraverseDecl(Decl *D) {
+        auto *Func = dyn_cast_or_null<FunctionDecl>(D);
+        if (!Func || !Func->doesThisDeclarationHaveABody()) return Base::TraverseDecl(D);
 
-        Stmt *Body = Func->getBody();
-        TraverseStmt(Body);
-        return true;
+        const uint32_t SavedFunc = currentFunc;
+        currentFunc = isFiltered(Func) ? NoNode : nodeFor(Func);
+        const bool Result = Base::TraverseDecl(D);
+        currentFunc = SavedFunc;
+        return Result;
     }
 
     bool VisitCallExpr(CallExpr *Call) {
+        if (currentFunc == NoNode) return true;
         if (FunctionDecl *Callee = Call->getDirectCallee()) {
-            callGraph[currentFunc].insert(Callee->getNameAsString());
+            if (!isFiltered(Callee)) Graph.addEdge(currentFunc, nodeFor(Callee));
         }
         return true;
     }
 
 private:
+    static constexpr uint32_t NoNode = ~0u;
+
+    bool isFiltered(const FunctionDecl *Func) const {
+        return !SystemHeaders && Context->getSourceManager().isInSystemHeader(Func->getLocation());
+    }
+
+    uint32_t nodeFor(const FunctionDecl *Func) {
+        std::string Name = Func->getQualifiedNameAsString();
+        llvm::SmallString<128> USR;
+        if (index::generateUSRForDecl(Func->getCanonicalDecl(), USR)) return Graph.intern(Name, Name);
+        return Graph.intern(USR.str(), Name);
+    }
+
     ASTContext *Context;
-    std::string currentFunc;
+    CallGraphStore &Graph;
+    uint32_t currentFunc = NoNode;
+};
+
+// Records every user (non-system) file the translation unit reads, for cache validation.
+class DependencyCollector : public PPCallbacks {
+public:
+    DependencyCollector(SourceManager &SM, std::set<std::string> &Files) : SM(SM), Files(Files) {}
+
+    void FileChanged(SourceLocation Loc, FileChangeReason Reason, SrcMgr::CharacteristicKind FileType,
+                     FileID PrevFID) override {
+        if (Reason != EnterFile || FileType != SrcMgr::C_User) return;
+        if (const FileEntry *File = SM.getFileEntryForID(SM.getFileID(Loc))) {
+            StringRef Path = File->tryGetRealPathName();
+            Files.insert((Path.empty() ? File->getName() : Path).str());
+        }
+    }
+
+private:
+    SourceManager &SM;
+    std::set<std::string> &Files;
+};
+
+// Output of one translation unit.
+struct TUResult {
+    CallGraphStore Graph;
+    std::set<std::string> Dependencies;
 };
 
 class CallGraphConsumer : public ASTConsumer {
 public:
-    explicit CallGraphConsumer(ASTContext *Context) : Visitor(Context) {}
+    CallGraphConsumer(ASTContext *Context, CallGraphStore &Graph) : Visitor(Context, Graph) {}
 
     void HandleTranslationUnit(ASTContext &Context) override {
         Visitor.TraverseDecl(Context.getTranslationUnitDecl());
-
-        for (auto &[caller, callees] : callGraph) {
-            for (const auto &callee : callees) {
-                std::cout << caller << " -> " << callee << std::endl;
-            }
-        }
     }
 
 private:
@@ -61,20 +156,225 @@ private:
 
 class CallGraphAction : public ASTFrontendAction {
 public:
+    explicit CallGraphAction(TUResult &Result) : Result(Result) {}
+
     std::unique_ptr<ASTConsumer> CreateASTConsumer(CompilerInstance &CI, StringRef file) override {
-        return std::make_unique<CallGraphConsumer>(&CI.getASTContext());
+        CI.getPreprocessor().addPPCallbacks(
+            std::make_unique<DependencyCollector>(CI.getSourceManager(), Result.Dependencies));
+        return std::make_unique<CallGraphConsumer>(&CI.getASTContext(), Result.Graph);
     }
+
+private:
+    TUResult &Result;
 };
 
-static llvm::cl::OptionCategory ToolCategory("call-graph options");
+// Every action it creates records into the same translation-unit-local result.
+class CallGraphActionFactory : public FrontendActionFactory {
+public:
+    explicit CallGraphActionFactory(TUResult &Result) : Result(Result) {}
+
+    std::unique_ptr<FrontendAction> create() override {
+        return std::make_unique<CallGraphAction>(Result);
+    }
+
+private:
+    TUResult &Result;
+};
+
+// On-disk cache of per-TU graphs. An entry is keyed by a hash of the main file's contents,
+// its compile command and the options that change the graph; <key>.deps lists the hash of
+// every user header the TU read, and the entry is only reused while all of them still match.
+// System headers are not tracked: they change with the toolchain, which changes the command.
+class TUCache {
+public:
+    explicit TUCache(std::string Dir) : Dir(std::move(Dir)) {
+        if (!this->Dir.empty()) llvm::sys::fs::create_directories(this->Dir);
+    }
+
+    bool enabled() const { return !Dir.empty(); }
+
+    // 0 if the file cannot be read, which disables caching for it.
+    static uint64_t hashFile(const std::string &Path) {
+        auto Buffer = llvm::MemoryBuffer::getFile(Path);
+        if (!Buffer) return 0;
+        return llvm::xxHash64((*Buffer)->getBuffer());
+    }
+
+    uint64_t key(const std::string &File, const CompilationDatabase &Compilations) const {
+        uint64_t Content = hashFile(File);
+        if (Content == 0) return 0;
+        std::string Material = std::to_string(Content) + (SystemHeaders ? "|sys" : "|user") + "|cgstore1";
+        for (const CompileCommand &Cmd : Compilations.getCompileCommands(File)) {
+            Material += "|" + Cmd.Directory;
+            for (const std::string &Arg : Cmd.CommandLine) {
+                Material += '\0';
+                Material += Arg;
+            }
+        }
+        return llvm::xxHash64(Material);
+    }
+
+    bool load(uint64_t Key, CallGraphStore &Graph) const {
+        std::ifstream Deps(path(Key, ".deps"));
+        if (!Deps) return false;
+        std::string Line;
+        while (std::getline(Deps, Line)) {
+            size_t Space = Line.find(' ');
+            if (Space == std::string::npos) return false;
+            // An unreadable dependency is stale even if it was unreadable when stored.
+            const uint64_t Hash = hashFile(Line.substr(Space + 1));
+            if (Hash == 0 || std::to_string(Hash) != Line.substr(0, Space)) return false;
+        }
+        MappedCallGraph Mapped;
+        if (!Mapped.open(path(Key, ".cg"))) return false;
+        Graph.merge(Mapped);
+        return true;
+    }
+
+    void store(uint64_t Key, const TUResult &Result) const {
+        if (!Result.Graph.writeBinary(path(Key, ".cg"))) return;
+        const std::string Tmp = path(Key, ".deps.tmp");
+        {
+            std::ofstream Deps(Tmp);
+            for (const std::string &File : Result.Dependencies) Deps << hashFile(File) << " " << File << "\n";
+            if (!Deps) return;
+        }
+        std::rename(Tmp.c_str(), path(Key, ".deps").c_str());
+    }
+
+private:
+    std::string path(uint64_t Key, const char *Ext) const {
+        llvm::SmallString<256> P(Dir);
+        llvm::sys::path::append(P, llvm::utohexstr(Key) + Ext);
+        return std::string(P.str());
+    }
+
+    std::string Dir;
+};
+
+// Maps a graph file and prints it like a fresh analysis would; -o rewrites it.
+static int printStoredGraph() {
+    MappedCallGraph Mapped;
+    if (!Mapped.open(InputFile)) {
+        llvm::errs() << InputFile << " is not a readable call-graph file\n";
+        return 1;
+    }
+    CallGraphStore Graph;
+    Graph.merge(Mapped);
+
+    if (!OutputFile.empty() && !Graph.writeBinary(OutputFile)) {
+        llvm::errs() << "Failed to write " << OutputFile << "\n";
+        return 1;
+    }
+    if (Format == OutputFormat::Text) Graph.writeText(std::cout);
+    if (Format == OutputFormat::Dot) Graph.writeDot(std::cout);
+    return 0;
+}
+
+// CommonOptionsParser only loads a compilation database when it is given source files, so the
+// whole-database mode loads it here, from the directory its own -p option names.
+static std::unique_ptr<CompilationDatabase> loadDatabase(std::string &Error) {
+    std::string BuildPath = ".";
+    auto &Options = llvm::cl::getRegisteredOptions();
+    auto It = Options.find("p");
+    if (It != Options.end()) {
+        const std::string &Value = static_cast<llvm::cl::opt<std::string> *>(It->second)->getValue();
+        if (!Value.empty()) BuildPath = Value;
+    }
+    return CompilationDatabase::autoDetectFromDirectory(BuildPath, Error);
+}
 
+// Usage: CallGraphExtractor -p <build dir> [-j N] [-o graph.cg] [-format=text|dot|none]
+//                           [-cache-dir=DIR] [-system-headers] [source files...]
+//        CallGraphExtractor -i graph.cg [-format=text|dot] [-o copy.cg]
+// Without source files every file in the compilation database is analysed.
 int main(int argc, const char **argv) {
-    auto ExpectedParser = CommonOptionsParser::create(argc, argv, ToolCategory);
+    auto ExpectedParser = CommonOptionsParser::create(argc, argv, ToolCategory, llvm::cl::ZeroOrMore);
     if (!ExpectedParser) {
         llvm::errs() << ExpectedParser.takeError();
         return 1;
     }
+    if (!InputFile.empty()) {
+        if (!ExpectedParser->getSourcePathList().empty()) {
+            llvm::errs() << "-i cannot be combined with source files\n";
+            return 1;
+        }
+        return printStoredGraph();
+    }
+
+    std::vector<std::string> Files = ExpectedParser->getSourcePathList();
+    std::unique_ptr<CompilationDatabase> Database;
+    if (Files.empty()) {
+        std::string Error;
+        Database = loadDatabase(Error);
+        if (!Database) {
+            llvm::errs() << "No compilation database to analyse: " << Error << "\n";
+            return 1;
+        }
+        Files = Database->getAllFiles();
+    }
+    const CompilationDatabase &Compilations = Database ? *Database : ExpectedParser->getCompilations();
+    std::sort(Files.begin(), Files.end());
+    Files.erase(std::unique(Files.begin(), Files.end()), Files.end());
+
+    unsigned NumThreads = Jobs ? Jobs : std::max(1u, std::thread::hardware_concurrency());
+    NumThreads = std::min<unsigned>(NumThreads, std::max<size_t>(Files.size(), 1));
+
+    TUCache Cache(CacheDir);
+
+    // One partial graph per translation unit; workers never share one.
+    std::vector<TUResult> Partial(Files.size());
+    std::vector<int> Status(Files.size(), 0);
+    std::atomic<size_t> Next{0};
+    std::atomic<size_t> Finished{0};
+    std::mutex ErrsMutex;
+
+    auto Worker = [&]() {
+        for (size_t I = Next++; I < Files.size(); I = Next++) {
+            auto Start = std::chrono::steady_clock::now();
+
+            const uint64_t Key = Cache.enabled() ? Cache.key(Files[I], Compilations) : 0;
+            const bool Cached = Key != 0 && Cache.load(Key, Partial[I].Graph);
+            if (!Cached) {
+                // Each tool gets its own file system so the per-command working directory
+                // does not go through the process-wide chdir.
+                ClangTool Tool(Compilations, {Files[I]}, std::make_shared<PCHContainerOperations>(),
+                               llvm::vfs::createPhysicalFileSystem());
+                CallGraphActionFactory Factory(Partial[I]);
+                Status[I] = Tool.run(&Factory);
+                Partial[I].Graph.canonicalize();
+                if (Key != 0 && Status[I] == 0) Cache.store(Key, Partial[I]);
+            }
+
+            if (Timing) {
+                double Ms = std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() - Start).count();
+                std::lock_guard<std::mutex> Lock(ErrsMutex);
+                llvm::errs() << "[" << ++Finished << "/" << Files.size() << "] " << Files[I] << ": "
+                             << llvm::format("%.1f", Ms) << " ms" << (Cached ? " (cached)" : "")
+                             << (Status[I] ? " (failed)" : "") << "\n";
+            }
+        }
+    };
+
+    std::vector<std::thread> Threads;
+    for (unsigned T = 0; T < NumThreads; ++T) Threads.emplace_back(Worker);
+    for (auto &T : Threads) T.join();
+
+    // canonicalize() renumbers by USR and sorts the edges, so the result is the same for any -j.
+    CallGraphStore Merged;
+    for (auto &Result : Partial) Merged.merge(Result.Graph);
+    Merged.canonicalize();
+
+    if (!OutputFile.empty() && !Merged.writeBinary(OutputFile)) {
+        llvm::errs() << "Failed to write " << OutputFile << "\n";
+        return 1;
+    }
+    if (Format == OutputFormat::Text) Merged.writeText(std::cout);
+    if (Format == OutputFormat::Dot) Merged.writeDot(std::cout);
 
-    ClangTool Tool(ExpectedParser->getCompilations(), ExpectedParser->getSourcePathList());
-    return Tool.run(newFrontendActionFactory<CallGraphAction>().get());
+    // Same convention as ClangTool::run: 1 if any file failed to compile.
+    int Result = 0;
+    for (int S : Status) Result = std::max(Result, S);
+    return Result;
 }
@@ -10,106 +10,176 @@
 #include <random>
 #include <unordered_map>
 #include <chrono>
+#include <algorithm>
+#include <string>
+#include <iomanip>
 
 #include "dag_scheduler.hpp"
+#include "streaming_dag.hpp"
+#include "task_queue.hpp"
+#include "trace.hpp"
 
-// Phase 1 - Task + Queue + Processors
-struct Task {
-    int id;
-    std::vector<SubTask> subtasks;
-
-    void work() const {
-        std::cout << "[Task " << id << "] Starting DAG process\n";
-        DAGScheduler scheduler(subtasks);
-        scheduler.execute();
-        std::cout << "[Task " << id << "] DAG process complete\n";
-    }
-};
-
-class TaskQueue {
-private:
-    std::queue<Task> queue;
-    std::mutex mtx;
-    std::condition_variable cv;
-    bool shutdownFlag = false;
-
-public:
-    void push(const Task& task) {
-        std::unique_lock<std::mutex> lock(mtx);
-        queue.push(task);
-        cv.notify_one();
-    }
-
-    bool pop(Task& task) {
-        std::unique_lock<std::mutex> lock(mtx);
-        cv.wait(lock, [this]() { return !queue.empty() || shutdownFlag; });
-        if (shutdownFlag && queue.empty()) return false;
-        task = queue.front();
-        queue.pop();
-        return true;
-    }
-
-    void shutdown() {
-        std::unique_lock<std::mutex> lock(mtx);
-        shutdownFlag = true;
-        cv.notify_all();
-    }
-};
+static bool verbose = true;  // Console output for tasks and subtasks; --quiet turns it off
 
+// One simulated processor, i.e. one worker of the shared pool. When the worker has no
+// subtask to run or steal, it takes the next Task from the queue and starts that Task's DAG
+// on the same pool, so subtasks of different Tasks interleave across all processors and
+// total concurrency never exceeds the number of processors.
 class Processor {
 private:
     int id;
     TaskQueue& taskQueue;
-    std::atomic<int>& completedTasks;
+    RunningTaskPool& runners;
+    CompletionLatch& tasksDone;
 
 public:
-    Processor(int id, std::atomic<int>& completedTasks, TaskQueue& queue)
-        : id(id), completedTasks(completedTasks), taskQueue(queue) {}
+    Processor(int id, TaskQueue& queue, RunningTaskPool& runners, CompletionLatch& tasksDone)
+        : id(id), taskQueue(queue), runners(runners), tasksDone(tasksDone) {}
 
-    void operator()() {
+    // Idle poll for the pool's worker; returns false when there is no Task to start.
+    bool operator()(WorkStealingPool& pool) {
         Task task;
-        while (taskQueue.pop(task)) {
-            std::cout << "Processor " << id << " executing Task " << task.id << "\n";
-            task.work();
-            completedTasks++;
-        }
-        std::cout << "Processor " << id << " shutting down.\n";
+        if (!taskQueue.try_pop(task)) return false;
+
+        if (verbose) std::cout << "Processor " << id << " executing Task " << task.id << "\n";
+        Tracer::emit(TraceEvent::TaskBegin, id, task.id);
+
+        RunningTask* running = runners.acquire(std::move(task), id);
+        running->dag.setVerbose(verbose);
+        running->dag.executeAsync(pool, [this, running]() {
+            if (verbose) {
+                const DAGRunReport& r = running->dag.report();
+                std::cout << "[Task " << running->taskId << "] DAG process complete (makespan "
+                          << r.makespanMs << "ms, critical path " << r.criticalPathMs << "ms, efficiency "
+                          << 100.0 * r.efficiency() << "%)\n";
+            }
+            Tracer::emit(TraceEvent::TaskEnd, running->processor, running->taskId);
+            runners.release(running);
+            tasksDone.countDown();
+        });
+        return true;
     }
 };
 
-int main() {
-    const int NUM_PROCESSORS = 3;
+// A pipeline whose shape is only known while it runs: subtask 1 discovers a batch of items,
+// adds one subtask per item and a merge that waits for all of them, then seals the DAG. The
+// items start while the discovery is still running.
+static void runStreamingPipeline(WorkStealingPool& pool) {
+    const int NUM_ITEMS = 6;
+    StreamingDAG dag(pool);
+    dag.setVerbose(verbose);
+    dag.add(SubTask{1, [&dag]() {
+        std::vector<int> items;
+        for (int i = 0; i < NUM_ITEMS; ++i) {
+            const int id = 100 + i;
+            SubTask item{id, nullptr, {}, 1.0, nullptr};
+            item.coroutine = [id]() -> SubTaskCoroutine {
+                co_await sleepFor(std::chrono::milliseconds(50 + (id % 3) * 50));
+            };
+            dag.add(std::move(item));
+            items.push_back(id);
+        }
+        dag.add(SubTask{200, []() {}, std::move(items), 1.0, nullptr});
+        dag.seal();
+    }, {}, 1.0, nullptr});
+    dag.wait();
+
+    const DAGRunReport& r = dag.report();
+    std::cout << "[Streaming] " << dag.size() << " subtasks complete (makespan " << r.makespanMs
+              << "ms, critical path " << r.criticalPathMs << "ms, efficiency " << 100.0 * r.efficiency() << "%)\n";
+}
+
+// Usage: multiprocessor [--quiet] [--trace=PATH] [--pin] [--streaming]
+//   --quiet       suppress per-task and per-subtask output
+//   --trace=PATH  record a Chrome trace of tasks and subtasks
+//   --pin         pin each processor to its own core, neighbours sharing a cache (see cpu_topology.hpp)
+//   --streaming   afterwards, run a pipeline that adds subtasks while it runs (see streaming_dag.hpp)
+int main(int argc, char** argv) {
+    // Never more processors than cores, so the environment really models N processors.
+    const int NUM_PROCESSORS = static_cast<int>(std::min(3u, std::max(1u, std::thread::hardware_concurrency())));
     const int NUM_TASKS = 3;
 
+    std::string tracePath;
+    bool pin = false;
+    bool streaming = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--quiet") {
+            verbose = false;
+        } else if (arg.rfind("--trace=", 0) == 0) {
+            tracePath = arg.substr(8);
+        } else if (arg == "--pin") {
+            pin = true;
+        } else if (arg == "--streaming") {
+            streaming = true;
+        } else {
+            std::cerr << "Unknown option: " << arg << "\n";
+            return 1;
+        }
+    }
+    if (!tracePath.empty())
+        Tracer::start();
+
     TaskQueue taskQueue;
-    std::atomic<int> completedTasks{0};
+    RunningTaskPool runners;
+    CompletionLatch tasksDone(NUM_TASKS);
 
-    std::vector<std::thread> processors;
+    std::vector<Processor> processorState;
     for (int i = 0; i < NUM_PROCESSORS; ++i) {
-        processors.emplace_back(Processor(i + 1, completedTasks, taskQueue));
+        processorState.emplace_back(i + 1, taskQueue, runners, tasksDone);
     }
 
-    for (int i = 0; i < NUM_TASKS; ++i) {
-        std::vector<SubTask> subtasks = {
-            createSubTask(1, {}),
-            createSubTask(2, {1}),
-            createSubTask(3, {1}),
-            createSubTask(4, {2, 3}),
-            createSubTask(5, {4})
-        };
-        taskQueue.push(Task{i + 1, subtasks});
+    const CpuTopology topology = CpuTopology::detect();
+    WorkerAffinity affinity;
+    if (pin) {
+        affinity = topology.affinityFor(NUM_PROCESSORS);
+        std::cout << "CPU topology:\n" << topology.summary();
     }
 
-    while (completedTasks < NUM_TASKS) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    // Processor threads are the pool's workers: they run every Task's subtasks.
+    const auto runStart = std::chrono::steady_clock::now();
+    WorkStealingPool processors(NUM_PROCESSORS, [&processorState](WorkStealingPool& pool, unsigned worker) {
+        return processorState[worker](pool);
+    }, affinity);
+
+    // Every Task runs the same pipeline, so it is validated and laid out once.
+    std::vector<SubTask> subtasks;
+    subtasks.reserve(5);
+    subtasks.push_back(createSubTask(1, {}));
+    subtasks.push_back(createSubTask(2, {1}));
+    subtasks.push_back(createSubTask(3, {1}));
+    subtasks.push_back(createSubTask(4, {2, 3}));
+    subtasks.push_back(createSubTask(5, {4}));
+    auto pipeline = std::make_shared<CompiledDAG>(std::move(subtasks));
+
+    for (int i = 0; i < NUM_TASKS; ++i) {
+        taskQueue.push(Task{i + 1, pipeline});
+        processors.notify();
     }
 
+    tasksDone.wait();
     taskQueue.shutdown();
 
-    for (auto& p : processors) {
-        if (p.joinable()) p.join();
+    std::cout << "All tasks processed.\n";
+    if (streaming)
+        runStreamingPipeline(processors);
+
+    // Jobs (subtasks and coroutine resumptions) run per processor; with --pin, per core.
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+    for (int i = 0; i < NUM_PROCESSORS; ++i) {
+        const WorkStealingPool::WorkerStats st = processors.stats(i);
+        std::cout << "Processor " << i + 1 << " on " << (st.cpu >= 0 ? topology.describe(st.cpu) : "any cpu") << ": "
+                  << st.jobs << " jobs (" << st.steals << " stolen), " << std::fixed << std::setprecision(1)
+                  << st.jobs / seconds << " jobs/s\n";
+        std::cout.unsetf(std::ios::floatfield);
     }
 
-    std::cout << "All tasks processed.\n";
+    if (!tracePath.empty()) {
+        Tracer::stop();
+        if (!Tracer::writeChromeJson(tracePath)) {
+            std::cerr << "Failed to write " << tracePath << "\n";
+            return 1;
+        }
+    }
     return 0;
 }
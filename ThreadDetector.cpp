@@ -1,4 +1,5 @@
 #include "clang/AST/AST.h"
+#include "clang/AST/RecursiveASTVisitor.h"
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Frontend/FrontendActions.h"
 #include "clang/Tooling/CommonOptionsParser.h"
@@ -9,10 +10,74 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <cstdio>
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
 using namespace clang;
 using namespace clang::tooling;
 using namespace clang::ast_matchers;
 
+static llvm::cl::OptionCategory MyToolCategory("thread-detector options");
+
+enum class OutputFormat { Text, Json };
+
+static llvm::cl::opt<OutputFormat> Format(
+    "format", llvm::cl::desc("Report format"),
+    llvm::cl::values(clEnumValN(OutputFormat::Text, "text", "one line per finding (default)"),
+                     clEnumValN(OutputFormat::Json, "json", "a single JSON document on stdout")),
+    llvm::cl::init(OutputFormat::Text), llvm::cl::cat(MyToolCategory));
+
+// One reported pattern. `Related*` points at the lock a held-lock finding happens under.
+struct Finding {
+    std::string Kind;
+    std::string File;
+    unsigned Line = 0;
+    unsigned Column = 0;
+    std::string Function;
+    std::string Message;
+    std::string RelatedFile;
+    unsigned RelatedLine = 0;
+
+    // Headers are seen by several TUs; the ordering de-duplicates them.
+    bool operator<(const Finding &O) const {
+        return std::tie(File, Line, Column, Kind, Message) < std::tie(O.File, O.Line, O.Column, O.Kind, O.Message);
+    }
+};
+
+static std::set<Finding> Findings;
+
+static Finding makeFinding(StringRef Kind, SourceLocation Loc, const SourceManager &SM, const FunctionDecl *Func,
+                           std::string Message) {
+    Finding F;
+    F.Kind = Kind.str();
+    PresumedLoc P = SM.getPresumedLoc(SM.getExpansionLoc(Loc));
+    if (P.isValid()) {
+        F.File = P.getFilename();
+        F.Line = P.getLine();
+        F.Column = P.getColumn();
+    }
+    if (Func) F.Function = Func->getQualifiedNameAsString();
+    F.Message = std::move(Message);
+    return F;
+}
+
+static void report(Finding F) {
+    if (Format == OutputFormat::Text) {
+        llvm::outs() << F.File << ":" << F.Line << ":" << F.Column << ": [" << F.Kind << "] " << F.Message;
+        if (!F.Function.empty()) llvm::outs() << " (in " << F.Function << ")";
+        llvm::outs() << "\n";
+    }
+    Findings.insert(std::move(F));
+}
+
+static const auto ThreadClass = cxxRecordDecl(hasAnyName("::std::thread", "::std::jthread"));
+static const auto LockClass = cxxRecordDecl(hasAnyName("::std::lock_guard", "::std::unique_lock", "::std::scoped_lock"));
+static const auto CondVarClass = cxxRecordDecl(hasAnyName("::std::condition_variable", "::std::condition_variable_any"));
+
 // Matches variables that are either:
 // 1. Directly of type std::thread
 // 2. Templated with std::thread, e.g., std::vector<std::thread>
@@ -27,6 +92,46 @@ DeclarationMatcher threadVarMatcher = varDecl(
     )
 ).bind("threadVar");
 
+// Every block that declares a lock_guard / unique_lock / scoped_lock; the lock is held from
+// the declaration to the end of the block.
+StatementMatcher lockScopeMatcher = compoundStmt(
+    unless(isExpansionInSystemHeader()),
+    forEach(declStmt(has(varDecl(hasType(hasUnqualifiedDesugaredType(
+        recordType(hasDeclaration(LockClass))))).bind("lock"))).bind("lockDecl")),
+    forFunction(functionDecl().bind("func"))
+).bind("scope");
+
+// A new thread started by every iteration of a loop: a std::thread constructed from a
+// callable, an emplace into a container of threads, or pthread_create.
+StatementMatcher threadInLoopMatcher = stmt(
+    unless(isExpansionInSystemHeader()),
+    anyOf(
+        cxxConstructExpr(hasDeclaration(cxxConstructorDecl(
+            ofClass(ThreadClass), unless(isCopyConstructor()), unless(isMoveConstructor()),
+            unless(isDefaultConstructor())))),
+        cxxMemberCallExpr(callee(cxxMethodDecl(
+            hasAnyName("emplace_back", "emplace", "emplace_front"),
+            ofClass(classTemplateSpecializationDecl(hasTemplateArgument(0, refersToType(hasDeclaration(ThreadClass))))))),
+            unless(hasArgument(0, hasType(hasUnqualifiedDesugaredType(recordType(hasDeclaration(ThreadClass))))))),
+        callExpr(callee(functionDecl(hasName("::pthread_create"))))
+    ),
+    hasAncestor(stmt(anyOf(forStmt(), whileStmt(), doStmt(), cxxForRangeStmt())).bind("loop")),
+    forFunction(functionDecl().bind("func"))
+).bind("spawn");
+
+StatementMatcher notifyAllMatcher = cxxMemberCallExpr(
+    unless(isExpansionInSystemHeader()),
+    callee(cxxMethodDecl(hasName("notify_all"), ofClass(CondVarClass))),
+    on(expr().bind("cv")),
+    forFunction(functionDecl().bind("func"))
+).bind("notifyAll");
+
+StatementMatcher condVarWaitMatcher = cxxMemberCallExpr(
+    unless(isExpansionInSystemHeader()),
+    callee(cxxMethodDecl(hasAnyName("wait", "wait_for", "wait_until"), ofClass(CondVarClass))),
+    on(expr().bind("cv"))
+).bind("wait");
+
 class ThreadVarCallback : public MatchFinder::MatchCallback {
 public:
     int threadCount = 0;
@@ -35,32 +140,292 @@ public:
         const VarDecl *var = Result.Nodes.getNodeAs<VarDecl>("threadVar");
         if (var) {
             ++threadCount;
-            llvm::outs() << "Found std::thread variable: " << var->getNameAsString()
-                         << " at " << var->getBeginLoc().printToString(*Result.SourceManager)
-                         << "\n";
+            if (Format == OutputFormat::Text) {
+                llvm::outs() << "Found std::thread variable: " << var->getNameAsString()
+                             << " at " << var->getBeginLoc().printToString(*Result.SourceManager)
+                             << "\n";
+            }
+            Findings.insert(makeFinding("thread-variable", var->getBeginLoc(), *Result.SourceManager, nullptr,
+                                        "std::thread variable '" + var->getNameAsString() + "'"));
         }
     }
 };
 
+static bool isOstream(const CXXRecordDecl *RD) {
+    if (!RD || !RD->hasDefinition()) return false;
+    if (RD->getName() == "basic_ostream") return true;
+    for (const CXXBaseSpecifier &Base : RD->bases()) {
+        if (isOstream(Base.getType()->getAsCXXRecordDecl())) return true;
+    }
+    return false;
+}
+
+// Walks the statements that run while one lock is held and records what should not happen
+// there: sleeping, joining, console/stream output, explicit allocation and taking another lock.
+// Lambda bodies are skipped (they run later, usually on another thread) and the scan stops at
+// an explicit unlock() of the lock.
+class HeldLockScanner : public RecursiveASTVisitor<HeldLockScanner> {
+public:
+    HeldLockScanner(const VarDecl *Lock, const SourceManager &SM, const FunctionDecl *Func)
+        : Lock(Lock), SM(SM), Func(Func) {}
+
+    bool released() const { return Released; }
+
+    bool TraverseLambdaExpr(LambdaExpr *) { return true; }
+
+    bool VisitCallExpr(CallExpr *Call) {
+        if (Released) return true;
+        const FunctionDecl *Callee = Call->getDirectCallee();
+        if (!Callee) return true;
+        const std::string Name = Callee->getQualifiedNameAsString();
+
+        if (auto *Member = dyn_cast<CXXMemberCallExpr>(Call)) {
+            // Conversion and overloaded operators have no simple name; getName() asserts on them.
+            const StringRef Method = Callee->getIdentifier() ? Callee->getName() : StringRef();
+            const Expr *Object = Member->getImplicitObjectArgument();
+            if (Object) {
+                if (auto *Ref = dyn_cast<DeclRefExpr>(Object->IgnoreParenImpCasts())) {
+                    if (Ref->getDecl() == Lock && Method == "unlock") {
+                        Released = true;
+                        return true;
+                    }
+                }
+            }
+            const CXXRecordDecl *Class = Member->getRecordDecl();
+            if (Method == "lock" && Class && Class->getName().contains("mutex")) {
+                flag(Call, "nested-lock", "locks another mutex");
+                return true;
+            }
+            if (Method == "join" && Class && Class->getName() == "thread") {
+                flag(Call, "blocking", "joins a thread");
+                return true;
+            }
+        }
+
+        if (StringRef(Name).startswith("std::this_thread::sleep_")) {
+            flag(Call, "blocking", "calls " + Name);
+        } else if (auto *Op = dyn_cast<CXXOperatorCallExpr>(Call);
+                   Op && Op->getOperator() == OO_LessLess && Op->getNumArgs() > 0 &&
+                   isOstream(Op->getArg(0)->getType()->getAsCXXRecordDecl())) {
+            flag(Call, "io", "writes to a stream");
+        } else if (Name == "printf" || Name == "puts" || Name == "fprintf" || Name == "fwrite" ||
+                   Name == "std::printf" || Name == "std::puts" || Name == "std::fprintf") {
+            flag(Call, "io", "calls " + Name);
+        } else if (Name == "std::make_unique" || Name == "std::make_shared" || Name == "malloc" ||
+                   Name == "calloc" || Name == "std::malloc") {
+            flag(Call, "allocation", "calls " + Name);
+        }
+        return true;
+    }
+
+    bool VisitCXXNewExpr(CXXNewExpr *New) {
+        if (!Released) flag(New, "allocation", "allocates with new");
+        return true;
+    }
+
+    bool VisitVarDecl(VarDecl *Var) {
+        if (Released) return true;
+        const CXXRecordDecl *RD = Var->getType()->getAsCXXRecordDecl();
+        if (RD && (RD->getName() == "lock_guard" || RD->getName() == "unique_lock" || RD->getName() == "scoped_lock")) {
+            Finding F = makeFinding("lock-held-nested-lock", Var->getBeginLoc(), SM, Func,
+                                    "takes lock '" + Var->getNameAsString() + "' while holding '" +
+                                        Lock->getNameAsString() + "'");
+            relate(F);
+            report(std::move(F));
+        }
+        return true;
+    }
+
+private:
+    void flag(const Stmt *S, StringRef Category, std::string What) {
+        // A chain like `std::cout << a << b` is several calls on one line; report it once.
+        const unsigned Line = SM.getExpansionLineNumber(S->getBeginLoc());
+        if (!Reported.insert({Category.str(), Line}).second) return;
+        Finding F = makeFinding(("lock-held-" + Category).str(), S->getBeginLoc(), SM, Func,
+                                What + " while holding '" + Lock->getNameAsString() + "'");
+        relate(F);
+        report(std::move(F));
+    }
+
+    void relate(Finding &F) const {
+        PresumedLoc P = SM.getPresumedLoc(SM.getExpansionLoc(Lock->getBeginLoc()));
+        if (P.isValid()) {
+            F.RelatedFile = P.getFilename();
+            F.RelatedLine = P.getLine();
+        }
+    }
+
+    const VarDecl *Lock;
+    const SourceManager &SM;
+    const FunctionDecl *Func;
+    bool Released = false;
+    std::set<std::pair<std::string, unsigned>> Reported;
+};
+
+class LockScopeCallback : public MatchFinder::MatchCallback {
+public:
+    void run(const MatchFinder::MatchResult &Result) override {
+        const auto *Scope = Result.Nodes.getNodeAs<CompoundStmt>("scope");
+        const auto *LockDecl = Result.Nodes.getNodeAs<DeclStmt>("lockDecl");
+        const auto *Lock = Result.Nodes.getNodeAs<VarDecl>("lock");
+        const auto *Func = Result.Nodes.getNodeAs<FunctionDecl>("func");
+
+        HeldLockScanner Scanner(Lock, *Result.SourceManager, Func);
+        bool Held = false;
+        for (Stmt *S : Scope->body()) {
+            if (S == LockDecl) {
+                Held = true;
+                continue;
+            }
+            if (!Held) continue;
+            Scanner.TraverseStmt(S);
+            if (Scanner.released()) break;
+        }
+    }
+};
+
+class ThreadInLoopCallback : public MatchFinder::MatchCallback {
+public:
+    void run(const MatchFinder::MatchResult &Result) override {
+        const auto *Spawn = Result.Nodes.getNodeAs<Stmt>("spawn");
+        const auto *Loop = Result.Nodes.getNodeAs<Stmt>("loop");
+        const auto *Func = Result.Nodes.getNodeAs<FunctionDecl>("func");
+        const SourceManager &SM = *Result.SourceManager;
+
+        Finding F = makeFinding("thread-created-in-loop", Spawn->getBeginLoc(), SM, Func,
+                                "starts a thread on every loop iteration; a fixed pool avoids the "
+                                "create/join cost and bounds the thread count");
+        PresumedLoc P = SM.getPresumedLoc(SM.getExpansionLoc(Loop->getBeginLoc()));
+        if (P.isValid()) {
+            F.RelatedFile = P.getFilename();
+            F.RelatedLine = P.getLine();
+        }
+        report(std::move(F));
+    }
+};
+
+// notify_all() wakes every waiter, and all but one usually go straight back to sleep. It is
+// flagged when the condition variable has a single wait site in the translation unit (so all
+// waiters wait for the same thing), except in destructors and shutdown-like functions where
+// waking everyone is the point.
+class NotifyAllCallback : public MatchFinder::MatchCallback {
+public:
+    void run(const MatchFinder::MatchResult &Result) override {
+        const ValueDecl *CondVar = declOf(Result.Nodes.getNodeAs<Expr>("cv"));
+        if (!CondVar) return;
+
+        if (Result.Nodes.getNodeAs<CXXMemberCallExpr>("wait")) {
+            ++WaitSites[CondVar];
+            return;
+        }
+
+        const auto *Call = Result.Nodes.getNodeAs<CXXMemberCallExpr>("notifyAll");
+        const auto *Func = Result.Nodes.getNodeAs<FunctionDecl>("func");
+        if (isShutdownPath(Func)) return;
+        Pending.push_back({CondVar, makeFinding("notify-all", Call->getBeginLoc(), *Result.SourceManager, Func, "")});
+    }
+
+    void onEndOfTranslationUnit() override {
+        for (auto &[CondVar, F] : Pending) {
+            const int Sites = WaitSites[CondVar];
+            if (Sites > 1) continue;
+            F.Message = "notify_all() on '" + CondVar->getNameAsString() + "', which is waited on at " +
+                        std::to_string(Sites) + " site" + (Sites == 1 ? "" : "s") +
+                        "; notify_one() is enough unless one change lets several waiters proceed";
+            report(F);
+        }
+        Pending.clear();
+        WaitSites.clear();
+    }
+
+private:
+    static const ValueDecl *declOf(const Expr *E) {
+        if (!E) return nullptr;
+        E = E->IgnoreParenImpCasts();
+        if (auto *Ref = dyn_cast<DeclRefExpr>(E)) return Ref->getDecl();
+        if (auto *Member = dyn_cast<MemberExpr>(E)) return Member->getMemberDecl();
+        return nullptr;
+    }
+
+    static bool isShutdownPath(const FunctionDecl *Func) {
+        if (!Func) return false;
+        if (isa<CXXDestructorDecl>(Func)) return true;
+        std::string Name = Func->getNameAsString();
+        for (char &C : Name) C = static_cast<char>(tolower(C));
+        for (const char *Word : {"stop", "shutdown", "close", "cancel", "terminate", "quit", "exit"}) {
+            if (Name.find(Word) != std::string::npos) return true;
+        }
+        return false;
+    }
+
+    std::map<const ValueDecl *, int> WaitSites;
+    std::vector<std::pair<const ValueDecl *, Finding>> Pending;
+};
+
 class ThreadFrontendAction : public ASTFrontendAction {
 public:
     void EndSourceFileAction() override {
-        llvm::outs() << "Total threads found: " << threadCallback.threadCount << "\n";
+        if (Format == OutputFormat::Text)
+            llvm::outs() << "Total threads found: " << threadCallback.threadCount << "\n";
     }
 
     std::unique_ptr<ASTConsumer> CreateASTConsumer(CompilerInstance &CI,
                                                    StringRef file) override {
         finder.addMatcher(threadVarMatcher, &threadCallback);
+        finder.addMatcher(lockScopeMatcher, &lockScopeCallback);
+        finder.addMatcher(threadInLoopMatcher, &threadInLoopCallback);
+        finder.addMatcher(notifyAllMatcher, &notifyAllCallback);
+        finder.addMatcher(condVarWaitMatcher, &notifyAllCallback);
         return finder.newASTConsumer();
     }
 
 private:
     ThreadVarCallback threadCallback;
+    LockScopeCallback lockScopeCallback;
+    ThreadInLoopCallback threadInLoopCallback;
+    NotifyAllCallback notifyAllCallback;
     MatchFinder finder;
 };
 
-static llvm::cl::OptionCategory MyToolCategory("thread-detector options");
+static std::string jsonString(StringRef S) {
+    std::string Out = "\"";
+    for (char C : S) {
+        switch (C) {
+        case '"': Out += "\\\""; break;
+        case '\\': Out += "\\\\"; break;
+        case '\n': Out += "\\n"; break;
+        case '\t': Out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(C) < 0x20) {
+                char Escaped[8];
+                snprintf(Escaped, sizeof(Escaped), "\\u%04x", static_cast<unsigned>(C));
+                Out += Escaped;
+            } else {
+                Out += C;
+            }
+        }
+    }
+    return Out + "\"";
+}
+
+static void writeJson(llvm::raw_ostream &OS) {
+    OS << "{\"findings\": [";
+    bool First = true;
+    for (const Finding &F : Findings) {
+        OS << (First ? "" : ",") << "\n  {\"kind\": " << jsonString(F.Kind) << ", \"file\": " << jsonString(F.File)
+           << ", \"line\": " << F.Line << ", \"column\": " << F.Column;
+        if (!F.Function.empty()) OS << ", \"function\": " << jsonString(F.Function);
+        OS << ", \"message\": " << jsonString(F.Message);
+        if (!F.RelatedFile.empty()) {
+            OS << ", \"related\": {\"file\": " << jsonString(F.RelatedFile) << ", \"line\": " << F.RelatedLine << "}";
+        }
+        OS << "}";
+        First = false;
+    }
+    OS << "\n]}\n";
+}
 
+// Usage: ThreadDetector [-format=text|json] <source files> [-- <compiler args>]
 int main(int argc, const char **argv) {
     auto ExpectedParser = CommonOptionsParser::create(argc, argv, MyToolCategory);
     if (!ExpectedParser) {
@@ -70,5 +435,7 @@ int main(int argc, const char **argv) {
     CommonOptionsParser &OptionsParser = ExpectedParser.get();
     ClangTool Tool(OptionsParser.getCompilations(),
                    OptionsParser.getSourcePathList());
-    return Tool.run(newFrontendActionFactory<ThreadFrontendAction>().get());
+    int Status = Tool.run(newFrontendActionFactory<ThreadFrontendAction>().get());
+    if (Format == OutputFormat::Json) writeJson(llvm::outs());
+    return Status;
 }
@@ -0,0 +1,605 @@
+#include "clang/AST/AST.h"
+#include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/Frontend/CompilerInstance.h"
+#include "clang/Frontend/FrontendActions.h"
+#include "clang/Index/USRGeneration.h"
+#include "clang/Tooling/CommonOptionsParser.h"
+#include "clang/Tooling/Tooling.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "callgraph_store.hpp"
+
+using namespace clang;
+using namespace clang::tooling;
+
+static llvm::cl::OptionCategory ToolCategory("thread-reachability options");
+
+enum class OutputFormat { Text, Json };
+
+static llvm::cl::opt<OutputFormat> Format(
+    "format", llvm::cl::desc("Report format"),
+    llvm::cl::values(clEnumValN(OutputFormat::Text, "text", "human-readable report (default)"),
+                     clEnumValN(OutputFormat::Json, "json", "a single JSON document on stdout")),
+    llvm::cl::init(OutputFormat::Text), llvm::cl::cat(ToolCategory));
+
+static llvm::cl::opt<bool> SystemHeaders(
+    "system-headers", llvm::cl::desc("Keep functions and globals declared in system headers (std::cout etc.)"),
+    llvm::cl::init(false), llvm::cl::cat(ToolCategory));
+
+static llvm::cl::opt<bool> ReadOnlyGlobals(
+    "read-only-globals", llvm::cl::desc("Also report globals that are only ever read"),
+    llvm::cl::init(false), llvm::cl::cat(ToolCategory));
+
+// How a function uses a global. Unknown covers taking its address or binding a non-const
+// reference to it, which may lead to a write somewhere else.
+enum class AccessKind { Read, Write, Unknown };
+
+static const char *accessName(AccessKind Kind) {
+    switch (Kind) {
+    case AccessKind::Read: return "read";
+    case AccessKind::Write: return "write";
+    case AccessKind::Unknown: return "address-taken";
+    }
+    return "";
+}
+
+// One std::thread / std::jthread / std::async / pthread_create call and the callables its
+// new thread starts in. A spawn inside a loop starts several threads with the same entry.
+struct SpawnSite {
+    std::string Kind;
+    std::string Location;
+    uint32_t Spawner;
+    std::vector<uint32_t> Entries;
+    bool InLoop = false;
+};
+
+struct GlobalInfo {
+    std::string Name;
+    std::string Type;
+    std::string Location;
+    bool Atomic = false;
+};
+
+// Everything the analysis keeps across translation units. Functions and globals are keyed by
+// USR, so a function defined in one TU and spawned from another is the same node.
+struct ProgramModel {
+    CallGraphStore Graph;
+    std::vector<SpawnSite> Spawns;
+    std::vector<uint32_t> MainEntries;
+    std::map<std::string, GlobalInfo> Globals;
+    std::set<std::tuple<uint32_t, std::string, AccessKind>> Accesses;
+};
+
+static std::string locationOf(SourceLocation Loc, const SourceManager &SM) {
+    PresumedLoc P = SM.getPresumedLoc(SM.getExpansionLoc(Loc));
+    if (P.isInvalid()) return "<unknown>";
+    return std::string(P.getFilename()) + ":" + std::to_string(P.getLine());
+}
+
+// Builds the call graph, the spawn sites and the global accesses in one walk of the AST.
+//
+// Calls are attributed to the innermost enclosing function. A lambda body is a node of its
+// own: a lambda handed straight to a spawn site only runs on the new thread, any other lambda
+// is assumed to run on behalf of the function that creates it (sort comparators, pool jobs)
+// and gets an edge from it.
+class ReachabilityVisitor : public RecursiveASTVisitor<ReachabilityVisitor> {
+    using Base = RecursiveASTVisitor<ReachabilityVisitor>;
+
+public:
+    ReachabilityVisitor(ASTContext &Context, ProgramModel &Model)
+        : Context(Context), SM(Context.getSourceManager()), Model(Model) {}
+
+    bool TraverseDecl(Decl *D) {
+        auto *Func = dyn_cast_or_null<FunctionDecl>(D);
+        if (!Func || !Func->doesThisDeclarationHaveABody()) return Base::TraverseDecl(D);
+
+        const uint32_t SavedFunc = CurrentFunc;
+        const unsigned SavedLoops = LoopDepth;
+        CurrentFunc = isFiltered(Func) ? NoNode : nodeFor(Func);
+        LoopDepth = 0;
+        if (CurrentFunc != NoNode && Func->isMain()) Model.MainEntries.push_back(CurrentFunc);
+        const bool Result = Base::TraverseDecl(D);
+        CurrentFunc = SavedFunc;
+        LoopDepth = SavedLoops;
+        return Result;
+    }
+
+    bool TraverseLambdaExpr(LambdaExpr *Lambda) {
+        const uint32_t SavedFunc = CurrentFunc;
+        const unsigned SavedLoops = LoopDepth;
+        if (CurrentFunc != NoNode) {
+            const uint32_t Body = nodeFor(Lambda->getCallOperator());
+            if (!SpawnedLambdas.count(Lambda)) Model.Graph.addEdge(CurrentFunc, Body);
+            CurrentFunc = Body;
+        }
+        LoopDepth = 0;
+        const bool Result = Base::TraverseLambdaExpr(Lambda);
+        CurrentFunc = SavedFunc;
+        LoopDepth = SavedLoops;
+        return Result;
+    }
+
+    bool TraverseForStmt(ForStmt *S) { return inLoop([&] { return Base::TraverseForStmt(S); }); }
+    bool TraverseWhileStmt(WhileStmt *S) { return inLoop([&] { return Base::TraverseWhileStmt(S); }); }
+    bool TraverseDoStmt(DoStmt *S) { return inLoop([&] { return Base::TraverseDoStmt(S); }); }
+    bool TraverseCXXForRangeStmt(CXXForRangeStmt *S) {
+        return inLoop([&] { return Base::TraverseCXXForRangeStmt(S); });
+    }
+
+    bool VisitCallExpr(CallExpr *Call) {
+        if (CurrentFunc == NoNode) return true;
+        const FunctionDecl *Callee = Call->getDirectCallee();
+        if (!Callee) return true;
+        const std::string Name = Callee->getQualifiedNameAsString();
+
+        if (Name == "std::async") {
+            // std::async(f, ...) or std::async(policy, f, ...)
+            for (unsigned I = 0; I < Call->getNumArgs(); ++I) {
+                const auto *Enum = Call->getArg(I)->getType()->getAs<EnumType>();
+                if (Enum && Enum->getDecl()->getQualifiedNameAsString() == "std::launch") continue;
+                spawn("std::async", Call, Call->getArg(I));
+                break;
+            }
+        } else if (Name == "pthread_create" && Call->getNumArgs() >= 3) {
+            spawn("pthread_create", Call, Call->getArg(2));
+        } else if (isThreadEmplace(Call, Callee)) {
+            spawn("std::thread", Call, Call->getArg(0));
+        }
+
+        if (!isFiltered(Callee)) Model.Graph.addEdge(CurrentFunc, nodeFor(Callee));
+        return true;
+    }
+
+    bool VisitCXXConstructExpr(CXXConstructExpr *Construct) {
+        if (CurrentFunc == NoNode) return true;
+        const CXXConstructorDecl *Ctor = Construct->getConstructor();
+        const std::string Class = Ctor->getParent()->getQualifiedNameAsString();
+        if ((Class == "std::thread" || Class == "std::jthread") && Construct->getNumArgs() > 0 &&
+            !Ctor->isCopyOrMoveConstructor()) {
+            spawn(Class, Construct, Construct->getArg(0));
+        } else if (!isFiltered(Ctor)) {
+            Model.Graph.addEdge(CurrentFunc, nodeFor(Ctor));
+        }
+        return true;
+    }
+
+    // The visitor is pre-order, so the operators below see a global before its DeclRefExpr
+    // does and can say how it is used.
+    bool VisitBinaryOperator(BinaryOperator *Op) {
+        if (Op->isAssignmentOp()) Uses[Op->getLHS()->IgnoreParenImpCasts()] = AccessKind::Write;
+        return true;
+    }
+
+    bool VisitUnaryOperator(UnaryOperator *Op) {
+        if (Op->isIncrementDecrementOp()) Uses[Op->getSubExpr()->IgnoreParenImpCasts()] = AccessKind::Write;
+        return true;
+    }
+
+    bool VisitImplicitCastExpr(ImplicitCastExpr *Cast) {
+        if (Cast->getCastKind() == CK_LValueToRValue) Uses.try_emplace(Cast->getSubExpr()->IgnoreParens(), AccessKind::Read);
+        return true;
+    }
+
+    // Member calls and overloaded operators on a global object: const methods read it,
+    // anything else (atomic fetch_add, container push_back, ostream <<) may write.
+    bool VisitCXXMemberCallExpr(CXXMemberCallExpr *Call) {
+        if (const Expr *Object = Call->getImplicitObjectArgument()) {
+            const CXXMethodDecl *Method = Call->getMethodDecl();
+            Uses.try_emplace(Object->IgnoreParenImpCasts(),
+                             Method && Method->isConst() ? AccessKind::Read : AccessKind::Write);
+        }
+        return true;
+    }
+
+    bool VisitCXXOperatorCallExpr(CXXOperatorCallExpr *Call) {
+        const auto *Method = dyn_cast_or_null<CXXMethodDecl>(Call->getDirectCallee());
+        if (Method && Call->getNumArgs() > 0) {
+            Uses.try_emplace(Call->getArg(0)->IgnoreParenImpCasts(),
+                             Method->isConst() ? AccessKind::Read : AccessKind::Write);
+        }
+        return true;
+    }
+
+    // `g.field = x` and `g[i] = x` write g.
+    bool VisitArraySubscriptExpr(ArraySubscriptExpr *Subscript) {
+        propagateUse(Subscript, Subscript->getBase());
+        return true;
+    }
+
+    bool VisitDeclRefExpr(DeclRefExpr *Ref) {
+        recordAccess(Ref, Ref->getDecl());
+        return true;
+    }
+
+    bool VisitMemberExpr(MemberExpr *Member) {
+        if (!Member->isArrow()) propagateUse(Member, Member->getBase());
+        recordAccess(Member, Member->getMemberDecl());
+        return true;
+    }
+
+private:
+    static constexpr uint32_t NoNode = ~0u;
+
+    template <typename F>
+    bool inLoop(F &&Traverse) {
+        ++LoopDepth;
+        const bool Result = Traverse();
+        --LoopDepth;
+        return Result;
+    }
+
+    void propagateUse(const Expr *Outer, const Expr *Inner) {
+        auto It = Uses.find(Outer);
+        if (It != Uses.end()) Uses.try_emplace(Inner->IgnoreParenImpCasts(), It->second);
+    }
+
+    bool isFiltered(const Decl *D) const {
+        return !SystemHeaders && SM.isInSystemHeader(D->getLocation());
+    }
+
+    static bool isThreadClass(QualType Type) {
+        const CXXRecordDecl *RD = Type.isNull() ? nullptr : Type->getAsCXXRecordDecl();
+        if (!RD) return false;
+        const std::string Name = RD->getQualifiedNameAsString();
+        return Name == "std::thread" || Name == "std::jthread";
+    }
+
+    // threads.emplace_back(f) constructs the std::thread inside the container.
+    static bool isThreadEmplace(const CallExpr *Call, const FunctionDecl *Callee) {
+        const auto *Method = dyn_cast<CXXMethodDecl>(Callee);
+        if (!Method || !Method->getIdentifier() || Call->getNumArgs() == 0) return false;  // Operators
+        if (Method->getName() != "emplace_back" && Method->getName() != "emplace_front") return false;
+        const auto *Container = dyn_cast<ClassTemplateSpecializationDecl>(Method->getParent());
+        if (!Container || Container->getTemplateArgs().size() == 0) return false;
+        const TemplateArgument &Element = Container->getTemplateArgs()[0];
+        if (Element.getKind() != TemplateArgument::Type || !isThreadClass(Element.getAsType())) return false;
+        return !isThreadClass(Call->getArg(0)->getType());
+    }
+
+    std::string displayName(const FunctionDecl *Func) const {
+        if (const auto *Method = dyn_cast<CXXMethodDecl>(Func)) {
+            if (Method->getParent()->isLambda()) return "lambda at " + locationOf(Method->getParent()->getBeginLoc(), SM);
+        }
+        return Func->getQualifiedNameAsString();
+    }
+
+    uint32_t nodeFor(const FunctionDecl *Func) {
+        const std::string Name = displayName(Func);
+        llvm::SmallString<128> USR;
+        if (index::generateUSRForDecl(Func->getCanonicalDecl(), USR)) return Model.Graph.intern(Name, Name);
+        return Model.Graph.intern(USR.str(), Name);
+    }
+
+    // The functions a spawn argument resolves to: a function or member function (possibly
+    // through & or std::ref/std::bind), a lambda, or an object whose operator() is called.
+    void resolveEntries(const Expr *E, std::vector<const FunctionDecl *> &Out) const {
+        if (!E) return;
+        E = E->IgnoreUnlessSpelledInSource()->IgnoreParenImpCasts();
+
+        if (const auto *Lambda = dyn_cast<LambdaExpr>(E)) {
+            Out.push_back(Lambda->getCallOperator());
+            return;
+        }
+        if (const auto *Op = dyn_cast<UnaryOperator>(E); Op && Op->getOpcode() == UO_AddrOf) {
+            resolveEntries(Op->getSubExpr(), Out);
+            return;
+        }
+        if (const auto *Ref = dyn_cast<DeclRefExpr>(E)) {
+            if (const auto *Func = dyn_cast<FunctionDecl>(Ref->getDecl())) {
+                Out.push_back(Func);
+                return;
+            }
+            // A function pointer variable: follow its initializer.
+            const auto *Var = dyn_cast<VarDecl>(Ref->getDecl());
+            if (Var && Var->getType()->isPointerType() && Var->getType()->getPointeeType()->isFunctionType()) {
+                resolveEntries(Var->getInit(), Out);
+                return;
+            }
+        }
+        if (const auto *Call = dyn_cast<CallExpr>(E)) {
+            const FunctionDecl *Callee = Call->getDirectCallee();
+            if (Callee && Call->getNumArgs() > 0) {
+                const std::string Name = Callee->getQualifiedNameAsString();
+                if (Name == "std::ref" || Name == "std::cref" || Name == "std::bind") {
+                    resolveEntries(Call->getArg(0), Out);
+                    return;
+                }
+            }
+        }
+        callOperators(E->getType().getNonReferenceType()->getAsCXXRecordDecl(), Out);
+    }
+
+    static void callOperators(const CXXRecordDecl *RD, std::vector<const FunctionDecl *> &Out) {
+        if (!RD || !RD->hasDefinition()) return;
+        RD = RD->getDefinition();
+        if (RD->isLambda()) {
+            Out.push_back(RD->getLambdaCallOperator());
+            return;
+        }
+        for (const CXXMethodDecl *Method : RD->methods()) {
+            if (Method->getOverloadedOperator() == OO_Call) Out.push_back(Method);
+        }
+        for (const CXXBaseSpecifier &Base : RD->bases()) callOperators(Base.getType()->getAsCXXRecordDecl(), Out);
+    }
+
+    void spawn(std::string Kind, const Expr *Site, const Expr *Callable) {
+        SpawnSite S;
+        S.Kind = std::move(Kind);
+        S.Location = locationOf(Site->getBeginLoc(), SM);
+        S.Spawner = CurrentFunc;
+        S.InLoop = LoopDepth > 0;
+
+        std::vector<const FunctionDecl *> Entries;
+        resolveEntries(Callable, Entries);
+        for (const FunctionDecl *Entry : Entries) S.Entries.push_back(nodeFor(Entry));
+
+        if (const auto *Lambda = dyn_cast<LambdaExpr>(Callable->IgnoreUnlessSpelledInSource()->IgnoreParenImpCasts()))
+            SpawnedLambdas.insert(Lambda);
+        Model.Spawns.push_back(std::move(S));
+    }
+
+    // Namespace-scope and static variables, static members and function-local statics that
+    // can change at run time. thread_local and const globals are not shared state.
+    void recordAccess(const Expr *Use, const ValueDecl *D) {
+        if (CurrentFunc == NoNode) return;
+        const auto *Var = dyn_cast<VarDecl>(D);
+        if (!Var || !Var->hasGlobalStorage() || Var->getTLSKind() != VarDecl::TLS_None) return;
+        if (Var->isConstexpr() || Var->getType().isConstQualified() || isFiltered(Var)) return;
+
+        llvm::SmallString<128> USR;
+        std::string Key = index::generateUSRForDecl(Var->getCanonicalDecl(), USR)
+                              ? Var->getQualifiedNameAsString() + "@" + locationOf(Var->getLocation(), SM)
+                              : std::string(USR.str());
+
+        auto It = Model.Globals.find(Key);
+        if (It == Model.Globals.end()) {
+            GlobalInfo Info;
+            Info.Name = Var->getQualifiedNameAsString();
+            Info.Type = Var->getType().getAsString(Context.getPrintingPolicy());
+            Info.Location = locationOf(Var->getLocation(), SM);
+            const CXXRecordDecl *RD = Var->getType()->getAsCXXRecordDecl();
+            Info.Atomic = RD && RD->getQualifiedNameAsString() == "std::atomic";
+            Model.Globals.emplace(Key, std::move(Info));
+        }
+
+        auto Kind = Uses.find(Use);
+        Model.Accesses.emplace(CurrentFunc, std::move(Key), Kind == Uses.end() ? AccessKind::Unknown : Kind->second);
+    }
+
+    ASTContext &Context;
+    const SourceManager &SM;
+    ProgramModel &Model;
+    uint32_t CurrentFunc = NoNode;
+    unsigned LoopDepth = 0;
+    llvm::DenseSet<const LambdaExpr *> SpawnedLambdas;
+    llvm::DenseMap<const Expr *, AccessKind> Uses;
+};
+
+class ReachabilityConsumer : public ASTConsumer {
+public:
+    explicit ReachabilityConsumer(ProgramModel &Model) : Model(Model) {}
+
+    void HandleTranslationUnit(ASTContext &Context) override {
+        ReachabilityVisitor Visitor(Context, Model);
+        Visitor.TraverseDecl(Context.getTranslationUnitDecl());
+    }
+
+private:
+    ProgramModel &Model;
+};
+
+class ReachabilityAction : public ASTFrontendAction {
+public:
+    explicit ReachabilityAction(ProgramModel &Model) : Model(Model) {}
+
+    std::unique_ptr<ASTConsumer> CreateASTConsumer(CompilerInstance &CI, StringRef file) override {
+        return std::make_unique<ReachabilityConsumer>(Model);
+    }
+
+private:
+    ProgramModel &Model;
+};
+
+class ReachabilityActionFactory : public FrontendActionFactory {
+public:
+    explicit ReachabilityActionFactory(ProgramModel &Model) : Model(Model) {}
+
+    std::unique_ptr<FrontendAction> create() override { return std::make_unique<ReachabilityAction>(Model); }
+
+private:
+    ProgramModel &Model;
+};
+
+// A thread of the program: the main thread or one spawn site.
+struct ThreadEntry {
+    std::string Label;
+    std::vector<uint32_t> Roots;
+    bool Many = false;  // Spawned in a loop, so it alone runs on several threads at once
+    std::vector<uint32_t> Reachable;
+};
+
+// Functions reachable from each root set, by breadth-first search over the call graph.
+static void computeReachable(const CallGraphStore &Graph, std::vector<ThreadEntry> &Threads) {
+    const size_t N = Graph.nodeCount();
+    std::vector<uint32_t> Offsets(N + 1, 0);
+    for (const auto &E : Graph.edgeList()) ++Offsets[E.caller + 1];
+    for (size_t I = 0; I < N; ++I) Offsets[I + 1] += Offsets[I];
+    std::vector<uint32_t> Targets(Graph.edgeCount());
+    std::vector<uint32_t> Fill(Offsets.begin(), Offsets.end() - 1);
+    for (const auto &E : Graph.edgeList()) Targets[Fill[E.caller]++] = E.callee;
+
+    std::vector<char> Seen(N);
+    for (ThreadEntry &T : Threads) {
+        std::fill(Seen.begin(), Seen.end(), 0);
+        std::vector<uint32_t> Queue;
+        for (uint32_t Root : T.Roots) {
+            if (!Seen[Root]) {
+                Seen[Root] = 1;
+                Queue.push_back(Root);
+            }
+        }
+        for (size_t Head = 0; Head < Queue.size(); ++Head) {
+            const uint32_t Node = Queue[Head];
+            for (uint32_t I = Offsets[Node]; I < Offsets[Node + 1]; ++I) {
+                if (!Seen[Targets[I]]) {
+                    Seen[Targets[I]] = 1;
+                    Queue.push_back(Targets[I]);
+                }
+            }
+        }
+        std::sort(Queue.begin(), Queue.end());
+        T.Reachable = std::move(Queue);
+    }
+}
+
+// A global touched from functions that, taken together, run on more than one thread.
+struct SharedGlobal {
+    const GlobalInfo *Info;
+    struct Accessor {
+        uint32_t Function;
+        AccessKind Kind;
+        std::vector<size_t> Threads;
+    };
+    std::vector<Accessor> Accessors;
+    std::set<size_t> Threads;
+    bool Written = false;
+};
+
+static std::string jsonString(StringRef S) {
+    std::string Out = "\"";
+    for (char C : S) {
+        switch (C) {
+        case '"': Out += "\\\""; break;
+        case '\\': Out += "\\\\"; break;
+        case '\n': Out += "\\n"; break;
+        case '\t': Out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(C) < 0x20) {
+                char Escaped[8];
+                snprintf(Escaped, sizeof(Escaped), "\\u%04x", static_cast<unsigned>(C));
+                Out += Escaped;
+            } else {
+                Out += C;
+            }
+        }
+    }
+    return Out + "\"";
+}
+
+static void writeText(llvm::raw_ostream &OS, const CallGraphStore &Graph, const std::vector<ThreadEntry> &Threads,
+                      const std::vector<SharedGlobal> &Shared) {
+    OS << "Threads:\n";
+    for (const ThreadEntry &T : Threads) {
+        OS << "  " << T.Label << (T.Many ? " (one per loop iteration)" : "") << ": ";
+        if (T.Roots.empty()) OS << "entry not resolved";
+        for (size_t I = 0; I < T.Roots.size(); ++I) OS << (I ? ", " : "") << Graph.name(T.Roots[I]);
+        OS << ", " << T.Reachable.size() << " functions reachable\n";
+    }
+
+    OS << "\nShared globals:\n";
+    if (Shared.empty()) OS << "  none\n";
+    for (const SharedGlobal &G : Shared) {
+        OS << "  " << G.Info->Name << " (" << G.Info->Type << ", " << G.Info->Location << ")"
+           << (G.Written ? "" : " read-only") << (G.Info->Atomic ? " atomic" : "") << "\n";
+        for (const auto &A : G.Accessors) {
+            OS << "    " << accessName(A.Kind) << " in " << Graph.name(A.Function) << " from ";
+            for (size_t I = 0; I < A.Threads.size(); ++I) OS << (I ? ", " : "") << Threads[A.Threads[I]].Label;
+            OS << "\n";
+        }
+    }
+}
+
+static void writeJson(llvm::raw_ostream &OS, const CallGraphStore &Graph, const std::vector<ThreadEntry> &Threads,
+                      const std::vector<SharedGlobal> &Shared) {
+    OS << "{\"threads\": [";
+    for (size_t T = 0; T < Threads.size(); ++T) {
+        OS << (T ? "," : "") << "\n  {\"id\": " << T << ", \"label\": " << jsonString(Threads[T].Label)
+           << ", \"many\": " << (Threads[T].Many ? "true" : "false") << ", \"entries\": [";
+        for (size_t I = 0; I < Threads[T].Roots.size(); ++I)
+            OS << (I ? ", " : "") << jsonString(Graph.name(Threads[T].Roots[I]));
+        OS << "], \"reachable\": " << Threads[T].Reachable.size() << "}";
+    }
+    OS << "\n], \"shared_globals\": [";
+    for (size_t G = 0; G < Shared.size(); ++G) {
+        const SharedGlobal &S = Shared[G];
+        OS << (G ? "," : "") << "\n  {\"name\": " << jsonString(S.Info->Name) << ", \"type\": " << jsonString(S.Info->Type)
+           << ", \"location\": " << jsonString(S.Info->Location) << ", \"written\": " << (S.Written ? "true" : "false")
+           << ", \"atomic\": " << (S.Info->Atomic ? "true" : "false") << ", \"accessors\": [";
+        for (size_t A = 0; A < S.Accessors.size(); ++A) {
+            OS << (A ? ", " : "") << "{\"function\": " << jsonString(Graph.name(S.Accessors[A].Function))
+               << ", \"access\": " << jsonString(accessName(S.Accessors[A].Kind)) << ", \"threads\": [";
+            for (size_t I = 0; I < S.Accessors[A].Threads.size(); ++I) OS << (I ? ", " : "") << S.Accessors[A].Threads[I];
+            OS << "]}";
+        }
+        OS << "]}";
+    }
+    OS << "\n]}\n";
+}
+
+// Usage: ThreadReachability [-format=text|json] [-read-only-globals] [-system-headers]
+//                           <source files> [-- <compiler args>]
+// All files are analysed together, so a thread spawned in one file and a global written in
+// another are joined through the shared call graph.
+int main(int argc, const char **argv) {
+    auto ExpectedParser = CommonOptionsParser::create(argc, argv, ToolCategory);
+    if (!ExpectedParser) {
+        llvm::errs() << ExpectedParser.takeError();
+        return 1;
+    }
+    CommonOptionsParser &OptionsParser = ExpectedParser.get();
+
+    ProgramModel Model;
+    ClangTool Tool(OptionsParser.getCompilations(), OptionsParser.getSourcePathList());
+    ReachabilityActionFactory Factory(Model);
+    const int Status = Tool.run(&Factory);
+
+    std::vector<ThreadEntry> Threads;
+    std::sort(Model.MainEntries.begin(), Model.MainEntries.end());
+    Model.MainEntries.erase(std::unique(Model.MainEntries.begin(), Model.MainEntries.end()), Model.MainEntries.end());
+    if (!Model.MainEntries.empty()) Threads.push_back(ThreadEntry{"main thread", Model.MainEntries, false, {}});
+    for (const SpawnSite &S : Model.Spawns) {
+        Threads.push_back(ThreadEntry{S.Kind + " at " + S.Location + " in " + Model.Graph.name(S.Spawner), S.Entries,
+                                      S.InLoop, {}});
+    }
+    computeReachable(Model.Graph, Threads);
+
+    std::vector<std::vector<size_t>> ThreadsOf(Model.Graph.nodeCount());
+    for (size_t T = 0; T < Threads.size(); ++T) {
+        for (uint32_t Node : Threads[T].Reachable) ThreadsOf[Node].push_back(T);
+    }
+
+    // Accesses are ordered by (function, global); regroup them per global.
+    std::map<std::string, SharedGlobal> ByGlobal;
+    for (const auto &[Function, Key, Kind] : Model.Accesses) {
+        if (ThreadsOf[Function].empty()) continue;
+        SharedGlobal &G = ByGlobal[Key];
+        G.Info = &Model.Globals.at(Key);
+        G.Accessors.push_back({Function, Kind, ThreadsOf[Function]});
+        G.Threads.insert(ThreadsOf[Function].begin(), ThreadsOf[Function].end());
+        G.Written |= Kind != AccessKind::Read;
+    }
+
+    std::vector<SharedGlobal> Shared;
+    for (auto &[Key, G] : ByGlobal) {
+        const bool ManyThreads = G.Threads.size() > 1 || (G.Threads.size() == 1 && Threads[*G.Threads.begin()].Many);
+        if (ManyThreads && (G.Written || ReadOnlyGlobals)) Shared.push_back(std::move(G));
+    }
+
+    if (Format == OutputFormat::Json)
+        writeJson(llvm::outs(), Model.Graph, Threads, Shared);
+    else
+        writeText(llvm::outs(), Model.Graph, Threads, Shared);
+    return Status;
+}
@@ -1,157 +1,176 @@
 #include <iostream>
-#include <queue>
 #include <thread>
 #include <chrono>
-#include <mutex>
-#include <condition_variable>
 #include <random>
-#include <vector>
-#include <map>
-#include <iomanip>
-#include <ctime>
-
-struct SimThread {
-    int id;
-    std::string name;
-    int burstTime;
-    int remainingBurstTime;  // This tracks remaining burst time
-
-    SimThread(int id, std::string name, int burstTime)
-        : id(id), name(name), burstTime(burstTime), remainingBurstTime(burstTime) {}
-};
-
-// Utility to get current time string
-std::string currentTime() {
-    auto now = std::chrono::system_clock::now();
-    std::time_t t = std::chrono::system_clock::to_time_t(now);
-    std::tm* now_tm = std::localtime(&t);
-
-    char buffer[10];
-    std::strftime(buffer, sizeof(buffer), "%H:%M:%S", now_tm);
-    return std::string(buffer);
-}
-
-class ThreadScheduler {
-private:
-    std::queue<SimThread> taskQueue;
-    std::mutex queueMutex;
-    std::condition_variable cv;
-    bool done = false;
-
-    std::map<int, std::vector<std::string>> processorAssignments;
-    std::mutex printMutex;
-    int timeQuantum;  // Time slice for Round Robin scheduling
-
-public:
-    ThreadScheduler(int tq) : timeQuantum(tq) {}
+#include <string>
+#include <memory>
+#include <exception>
+
+#include "thread_scheduler.hpp"
+
+// Usage: thread_sim [--virtual] [--quiet] [--local-queues] [--pin] [--policy=rr|srtf|mlfq|cfs|edf]
+//                   [--threads=N] [--processors=N] [--metrics-json=PATH] [--metrics-csv=PATH]
+//                   [--trace=PATH] [--workload=PATH] [--seed=N] [--arrival-rate=R]
+//                   [--bursts=uniform|pareto] [--max-burst=MS] [--pareto-shape=A] [--switch-cost-us=N]
+//                   [--migration-cost-us=N] [--cache-half-life-ms=N] [--adaptive-quantum] [--quantum=MS]
+//   --virtual       run on the discrete-event virtual clock instead of sleeping real threads
+//   --quiet         suppress per-event output
+//   --local-queues  per-processor run queues with work stealing (real-thread mode)
+//   --pin           pin each processor thread to its own core; steal from the nearest first
+//   --policy        run queue ordering (default rr); EDF deadlines are twice the burst time
+//   --metrics-json=PATH, --metrics-csv=PATH  export the run's timing metrics
+//   --trace=PATH    record a Chrome trace (chrome://tracing, ui.perfetto.dev) of every slice
+//   --workload=PATH replay a recorded workload (format in workload.hpp; "-" reads stdin)
+//                   instead of generating --threads threads
+//   --seed=N        seed of the generated workload (default: random)
+//   --arrival-rate=R  Poisson arrivals, R threads per second (default 0: all at time 0)
+//   --bursts        burst distribution, uniform 500-2500ms (default) or pareto from 500ms
+//   --max-burst=MS  upper end of the uniform bursts (default 2500) and cap on the Pareto ones (default none)
+//   --pareto-shape=A  tail index of the Pareto bursts (default 1.5; smaller is heavier)
+//   --switch-cost-us=N     virtual mode: processor time lost on every dispatch
+//   --migration-cost-us=N  virtual mode: cache refill when a thread resumes on another processor
+//   --cache-half-life-ms=N time away that halves the refill cost (default: no decay)
+//   --adaptive-quantum     virtual mode: size the quantum from the bursts of completed threads
+//   --quantum=MS           base time quantum (default 500ms)
+int main(int argc, char** argv) {
+    ThreadScheduler scheduler(500);  // 500ms time quantum for Round Robin
 
-    void addThread(const SimThread& t) {
-        std::lock_guard<std::mutex> lock(queueMutex);
-        taskQueue.push(t);
-        std::cout << "[+] Added thread " << t.name << " with burst time: " << t.burstTime << "ms\n";
-        cv.notify_one();
+    int numThreads = 10;
+    int numProcessors = 4;
+    bool virtualClock = false;
+    std::string metricsJson, metricsCsv, tracePath, workloadPath;
+    CostModel costModel;
+    SyntheticWorkload synthetic;
+    synthetic.seed = std::random_device()();
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--virtual") {
+            virtualClock = true;
+        } else if (arg == "--quiet") {
+            scheduler.setVerbose(false);
+        } else if (arg == "--local-queues") {
+            scheduler.setQueueMode(ThreadScheduler::QueueMode::PerProcessor);
+        } else if (arg == "--pin") {
+            scheduler.setPinning(true);
+        } else if (arg.rfind("--policy=", 0) == 0) {
+            scheduler.setPolicy(parsePolicy(arg.substr(9)));
+        } else if (arg.rfind("--metrics-json=", 0) == 0) {
+            metricsJson = arg.substr(15);
+        } else if (arg.rfind("--trace=", 0) == 0) {
+            tracePath = arg.substr(8);
+        } else if (arg.rfind("--metrics-csv=", 0) == 0) {
+            metricsCsv = arg.substr(14);
+        } else if (arg.rfind("--threads=", 0) == 0) {
+            numThreads = std::stoi(arg.substr(10));
+        } else if (arg.rfind("--processors=", 0) == 0) {
+            numProcessors = std::stoi(arg.substr(13));
+            if (numProcessors < 1) {
+                std::cerr << "Invalid option: " << arg << " (at least one processor)\n";
+                return 1;
+            }
+        } else if (arg.rfind("--workload=", 0) == 0) {
+            workloadPath = arg.substr(11);
+        } else if (arg.rfind("--seed=", 0) == 0) {
+            synthetic.seed = std::stoull(arg.substr(7));
+        } else if (arg.rfind("--arrival-rate=", 0) == 0) {
+            synthetic.arrivalRate = std::stod(arg.substr(15));
+        } else if (arg.rfind("--bursts=", 0) == 0) {
+            synthetic.bursts = parseBursts(arg.substr(9));
+        } else if (arg.rfind("--max-burst=", 0) == 0) {
+            synthetic.maxBurst = synthetic.paretoCap = std::stoi(arg.substr(12));
+        } else if (arg.rfind("--pareto-shape=", 0) == 0) {
+            synthetic.paretoShape = std::stod(arg.substr(15));
+        } else if (arg.rfind("--switch-cost-us=", 0) == 0) {
+            costModel.switchUs = std::stoll(arg.substr(17));
+        } else if (arg.rfind("--migration-cost-us=", 0) == 0) {
+            costModel.migrationUs = std::stoll(arg.substr(20));
+        } else if (arg.rfind("--cache-half-life-ms=", 0) == 0) {
+            costModel.cacheHalfLifeMs = std::stoll(arg.substr(21));
+        } else if (arg == "--adaptive-quantum") {
+            costModel.adaptiveQuantum = true;
+        } else if (arg.rfind("--quantum=", 0) == 0) {
+            scheduler.setQuantum(std::stoi(arg.substr(10)));
+        } else {
+            std::cerr << "Unknown option: " << arg << "\n";
+            return 1;
+        }
     }
 
-    void runWithProcessors(int numProcessors) {
-        std::vector<std::thread> processors;
-
-        for (int i = 0; i < numProcessors; ++i) {
-            processors.emplace_back([this, i]() {
-                while (true) {
-                    SimThread t(0, "", 0);
-                    {
-                        std::unique_lock<std::mutex> lock(queueMutex);
-                        cv.wait(lock, [this]() { return !taskQueue.empty() || done; });
-
-                        if (taskQueue.empty() && done)
-                            return;
-
-                        t = taskQueue.front();
-                        taskQueue.pop();
-                        processorAssignments[i].push_back(t.name);
-                    }
-
-                    {
-                        std::lock_guard<std::mutex> lock(printMutex);
-                        std::cout << "[" << currentTime() << "] [P" << i << "] Assigned: " << t.name
-                                  << " (burst: " << t.burstTime << "ms)\n";
-                    }
+    synthetic.count = numThreads;
+    scheduler.setCostModel(costModel);
+    std::unique_ptr<ArrivalSource> source;
+    try {
+        if (workloadPath.empty())
+            source = std::make_unique<SyntheticArrivalSource>(synthetic);
+        else
+            source = std::make_unique<TraceFileSource>(workloadPath);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
 
-                    // Run for the time quantum or remaining time, whichever is smaller
-                    int timeToRun = std::min(timeQuantum, t.remainingBurstTime);
-                    std::this_thread::sleep_for(std::chrono::milliseconds(timeToRun));
-                    t.remainingBurstTime -= timeToRun;
+    if (!tracePath.empty())
+        Tracer::start();
+
+    // A malformed trace line is only found when the run reaches it.
+    try {
+        if (virtualClock) {
+            scheduler.runSimulated(numProcessors, *source);
+        } else {
+            // Threads arriving at time 0 are queued before the processors start; later ones
+            // are added when the wall clock reaches their arrival time.
+            SimThread t(0, "", 0);
+            bool pending = source->next(t);
+            while (pending && t.arrivalTime <= 0) {
+                scheduler.addThread(t);
+                pending = source->next(t);
+            }
 
-                    // If there is remaining burst time, push it back into the queue
-                    if (t.remainingBurstTime > 0) {
-                        {
-                            std::lock_guard<std::mutex> lock(queueMutex);
-                            taskQueue.push(t);
-                        }
-                        {
-                            std::lock_guard<std::mutex> lock(printMutex);
-                            std::cout << "[" << currentTime() << "] [P" << i << "] Preempted: " << t.name
-                                      << " (remaining burst: " << t.remainingBurstTime << "ms)\n";
-                        }
-                    } else {
-                        {
-                            std::lock_guard<std::mutex> lock(printMutex);
-                            std::cout << "[" << currentTime() << "] [P" << i << "] Completed: " << t.name << "\n";
-                        }
-                    }
-                }
+            auto start = std::chrono::steady_clock::now();
+            std::thread schedulerThread([&scheduler, numProcessors]() {
+                scheduler.runWithProcessors(numProcessors);
             });
-        }
-
-        for (auto& p : processors)
-            p.join();
 
-        printAssignmentSummary(numProcessors);
-    }
-
-    void printAssignmentSummary(int numProcessors) {
-        std::cout << "\n=== Processor Assignment Summary ===\n";
-        for (int i = 0; i < numProcessors; ++i) {
-            std::cout << "Processor P" << i << " handled: ";
-            if (processorAssignments[i].empty()) {
-                std::cout << "None";
-            } else {
-                for (const auto& tName : processorAssignments[i]) {
-                    std::cout << tName << " ";
+            std::exception_ptr error;
+            try {
+                while (pending) {
+                    std::this_thread::sleep_until(start + std::chrono::milliseconds(t.arrivalTime));
+                    scheduler.addThread(t);
+                    pending = source->next(t);
                 }
+            } catch (...) {
+                error = std::current_exception();  // Let the processors finish first
             }
-            std::cout << "\n";
+
+            scheduler.markDone();
+            schedulerThread.join();
+            if (error)
+                std::rethrow_exception(error);
         }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
     }
 
-    void markDone() {
-        std::lock_guard<std::mutex> lock(queueMutex);
-        done = true;
-        cv.notify_all();
+    if (!tracePath.empty()) {
+        Tracer::stop();
+        if (!Tracer::writeChromeJson(tracePath)) {
+            std::cerr << "Failed to write " << tracePath << "\n";
+            return 1;
+        }
+        if (Tracer::droppedEvents() > 0)
+            std::cerr << "Trace buffers overflowed, dropped " << Tracer::droppedEvents() << " events\n";
     }
-};
 
-int main() {
-    ThreadScheduler scheduler(500);  // 500ms time quantum for Round Robin
-
-    const int numThreads = 10;
-    const int numProcessors = 4;
-
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dist(500, 2500); // burst times between 500–2500 ms
-
-    for (int i = 1; i <= numThreads; ++i) {
-        int burst = dist(gen);
-        scheduler.addThread(SimThread(i, "T" + std::to_string(i), burst));
+    if (!metricsJson.empty() && !scheduler.metrics().writeJson(metricsJson)) {
+        std::cerr << "Failed to write " << metricsJson << "\n";
+        return 1;
+    }
+    if (!metricsCsv.empty() && !scheduler.metrics().writeCsv(metricsCsv)) {
+        std::cerr << "Failed to write " << metricsCsv << "\n";
+        return 1;
     }
-
-    std::thread schedulerThread([&scheduler, numProcessors]() {
-        scheduler.runWithProcessors(numProcessors);
-    });
-
-    scheduler.markDone();
-    schedulerThread.join();
 
     return 0;
 }
@@ -0,0 +1,108 @@
+// alloc_counter.hpp
+#ifndef ALLOC_COUNTER_HPP
+#define ALLOC_COUNTER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+// Counts calls to the global operator new, aligned forms included. Exactly one translation unit of a program must
+// `#define ALLOC_COUNTER_REPLACE_NEW` before including this header to install the counting
+// operators; everywhere else AllocCounter only reads the counter.
+//
+//     AllocCounter::Scope scope;
+//     runHotPath();
+//     std::cout << scope.allocations() << " allocations\n";
+class AllocCounter {
+public:
+    static uint64_t total() { return count().load(std::memory_order_relaxed); }
+
+    static void record() { count().fetch_add(1, std::memory_order_relaxed); }
+
+    // Allocations made by any thread since the scope was created.
+    class Scope {
+    public:
+        Scope() : start(total()) {}
+        uint64_t allocations() const { return total() - start; }
+
+    private:
+        uint64_t start;
+    };
+
+private:
+    static std::atomic<uint64_t>& count() {
+        static std::atomic<uint64_t> allocations{0};
+        return allocations;
+    }
+};
+
+#ifdef ALLOC_COUNTER_REPLACE_NEW
+namespace alloc_counter_detail {
+
+inline void* allocate(std::size_t size) {
+    AllocCounter::record();
+    return std::malloc(size ? size : 1);
+}
+
+// aligned_alloc wants a size that is a multiple of the alignment.
+inline void* allocateAligned(std::size_t size, std::align_val_t alignment) {
+    AllocCounter::record();
+    const std::size_t align = static_cast<std::size_t>(alignment);
+    const std::size_t rounded = ((size ? size : 1) + align - 1) & ~(align - 1);
+    return std::aligned_alloc(align, rounded);
+}
+
+// Out of line, so that GCC does not inline a free() into code that called new and warn
+// about a mismatched pair (-Wmismatched-new-delete).
+[[gnu::noinline]] inline void release(void* p) noexcept { std::free(p); }
+
+}  // namespace alloc_counter_detail
+
+void* operator new(std::size_t size) {
+    if (void* p = alloc_counter_detail::allocate(size)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    if (void* p = alloc_counter_detail::allocate(size)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return alloc_counter_detail::allocate(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return alloc_counter_detail::allocate(size); }
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    if (void* p = alloc_counter_detail::allocateAligned(size, alignment)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    if (void* p = alloc_counter_detail::allocateAligned(size, alignment)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return alloc_counter_detail::allocateAligned(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return alloc_counter_detail::allocateAligned(size, alignment);
+}
+
+// Memory from malloc and aligned_alloc is released the same way.
+void operator delete(void* p) noexcept { alloc_counter_detail::release(p); }
+void operator delete[](void* p) noexcept { alloc_counter_detail::release(p); }
+void operator delete(void* p, std::size_t) noexcept { alloc_counter_detail::release(p); }
+void operator delete[](void* p, std::size_t) noexcept { alloc_counter_detail::release(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { alloc_counter_detail::release(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { alloc_counter_detail::release(p); }
+void operator delete(void* p, std::align_val_t) noexcept { alloc_counter_detail::release(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { alloc_counter_detail::release(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { alloc_counter_detail::release(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { alloc_counter_detail::release(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { alloc_counter_detail::release(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { alloc_counter_detail::release(p); }
+#endif
+
+#endif // ALLOC_COUNTER_HPP
@@ -0,0 +1,265 @@
+// callgraph_store.hpp
+#ifndef CALLGRAPH_STORE_HPP
+#define CALLGRAPH_STORE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+#include <ostream>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Binary call-graph file, little-endian, designed to be used in place through mmap:
+//
+//     FileHeader
+//     NodeEntry[nodeCount]   USR and display name of node i, as offsets into the string blob
+//     Edge[edgeCount]        sorted by (caller, callee), no duplicates
+//     char[stringBytes]      string blob
+namespace cgfile {
+
+constexpr char Magic[8] = {'C', 'G', 'S', 'T', 'O', 'R', 'E', '1'};
+
+struct FileHeader {
+    char magic[8];
+    uint32_t nodeCount;
+    uint32_t reserved;
+    uint64_t edgeCount;
+    uint64_t stringBytes;
+};
+
+struct NodeEntry {
+    uint32_t usrOffset;
+    uint32_t usrLength;
+    uint32_t nameOffset;
+    uint32_t nameLength;
+};
+
+struct Edge {
+    uint32_t caller;
+    uint32_t callee;
+
+    bool operator<(const Edge& o) const { return caller != o.caller ? caller < o.caller : callee < o.callee; }
+    bool operator==(const Edge& o) const { return caller == o.caller && callee == o.callee; }
+};
+
+} // namespace cgfile
+
+// Read-only view of a call-graph file. Nothing is copied: node strings and edges point into
+// the mapping, which lives as long as the view.
+class MappedCallGraph {
+public:
+    MappedCallGraph() = default;
+    MappedCallGraph(const MappedCallGraph&) = delete;
+    MappedCallGraph& operator=(const MappedCallGraph&) = delete;
+
+    ~MappedCallGraph() { close(); }
+
+    // False if the file is missing, truncated or not a call-graph file, or if any node string
+    // or edge endpoint lies outside it: every index is checked here, so readers need not.
+    bool open(const std::string& path) {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(cgfile::FileHeader))) {
+            ::close(fd);
+            return false;
+        }
+        void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+        base = static_cast<const char*>(p);
+        length = st.st_size;
+
+        if (!valid()) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        if (base) munmap(const_cast<char*>(base), length);
+        base = nullptr;
+        length = 0;
+    }
+
+    uint32_t nodeCount() const { return header()->nodeCount; }
+    uint64_t edgeCount() const { return header()->edgeCount; }
+
+    std::string_view usr(uint32_t node) const { return str(nodes()[node].usrOffset, nodes()[node].usrLength); }
+    std::string_view name(uint32_t node) const { return str(nodes()[node].nameOffset, nodes()[node].nameLength); }
+
+    const cgfile::Edge* edgesBegin() const { return reinterpret_cast<const cgfile::Edge*>(nodes() + nodeCount()); }
+    const cgfile::Edge* edgesEnd() const { return edgesBegin() + edgeCount(); }
+
+private:
+    bool valid() const {
+        const auto* h = header();
+        if (std::memcmp(h->magic, cgfile::Magic, sizeof(cgfile::Magic)) != 0) return false;
+        // Each count is bounded by the file size before it is multiplied, so the sum cannot wrap.
+        if (h->edgeCount > length / sizeof(cgfile::Edge) || h->stringBytes > length) return false;
+        const uint64_t expected = sizeof(cgfile::FileHeader) + uint64_t(h->nodeCount) * sizeof(cgfile::NodeEntry) +
+                                  h->edgeCount * sizeof(cgfile::Edge) + h->stringBytes;
+        if (expected != length) return false;
+
+        for (uint32_t i = 0; i < nodeCount(); ++i) {
+            const cgfile::NodeEntry& n = nodes()[i];
+            if (uint64_t(n.usrOffset) + n.usrLength > h->stringBytes) return false;
+            if (uint64_t(n.nameOffset) + n.nameLength > h->stringBytes) return false;
+        }
+        for (auto* e = edgesBegin(); e != edgesEnd(); ++e) {
+            if (e->caller >= nodeCount() || e->callee >= nodeCount()) return false;
+        }
+        return true;
+    }
+
+    const cgfile::FileHeader* header() const { return reinterpret_cast<const cgfile::FileHeader*>(base); }
+    const cgfile::NodeEntry* nodes() const {
+        return reinterpret_cast<const cgfile::NodeEntry*>(base + sizeof(cgfile::FileHeader));
+    }
+    std::string_view str(uint32_t offset, uint32_t len) const {
+        return std::string_view(reinterpret_cast<const char*>(edgesEnd()) + offset, len);
+    }
+
+    const char* base = nullptr;
+    size_t length = 0;
+};
+
+// Mutable call graph with nodes interned by USR, so overloads and same-named methods in
+// different scopes stay distinct while every edge is just two 32-bit ids.
+class CallGraphStore {
+public:
+    uint32_t intern(std::string_view usr, std::string_view name) {
+        auto it = ids.find(std::string(usr));
+        if (it != ids.end()) return it->second;
+        const uint32_t id = static_cast<uint32_t>(usrs.size());
+        usrs.emplace_back(usr);
+        names.emplace_back(name);
+        ids.emplace(usrs.back(), id);
+        return id;
+    }
+
+    void addEdge(uint32_t caller, uint32_t callee) { edges.push_back(cgfile::Edge{caller, callee}); }
+
+    size_t nodeCount() const { return usrs.size(); }
+    size_t edgeCount() const { return edges.size(); }
+    const std::string& usr(uint32_t node) const { return usrs[node]; }
+    const std::string& name(uint32_t node) const { return names[node]; }
+    const std::vector<cgfile::Edge>& edgeList() const { return edges; }
+
+    // Adds another graph's nodes and edges, re-mapping its ids through the USR table.
+    void merge(const CallGraphStore& other) {
+        std::vector<uint32_t> remap(other.nodeCount());
+        for (uint32_t i = 0; i < other.nodeCount(); ++i) remap[i] = intern(other.usrs[i], other.names[i]);
+        for (const auto& e : other.edges) addEdge(remap[e.caller], remap[e.callee]);
+    }
+
+    void merge(const MappedCallGraph& other) {
+        std::vector<uint32_t> remap(other.nodeCount());
+        for (uint32_t i = 0; i < other.nodeCount(); ++i) remap[i] = intern(other.usr(i), other.name(i));
+        for (auto* e = other.edgesBegin(); e != other.edgesEnd(); ++e) addEdge(remap[e->caller], remap[e->callee]);
+    }
+
+    // Renumbers the nodes in USR order and sorts and de-duplicates the edges, so the same set
+    // of calls always produces the same file regardless of the order it was recorded in.
+    void canonicalize() {
+        std::vector<uint32_t> order(usrs.size());
+        for (uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) { return usrs[a] < usrs[b]; });
+
+        std::vector<uint32_t> remap(usrs.size());
+        std::vector<std::string> sortedUsrs, sortedNames;
+        sortedUsrs.reserve(usrs.size());
+        sortedNames.reserve(names.size());
+        for (uint32_t k = 0; k < order.size(); ++k) {
+            remap[order[k]] = k;
+            sortedUsrs.push_back(std::move(usrs[order[k]]));
+            sortedNames.push_back(std::move(names[order[k]]));
+        }
+        usrs.swap(sortedUsrs);
+        names.swap(sortedNames);
+        ids.clear();
+        for (uint32_t i = 0; i < usrs.size(); ++i) ids.emplace(usrs[i], i);
+
+        for (auto& e : edges) e = cgfile::Edge{remap[e.caller], remap[e.callee]};
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    }
+
+    // Call canonicalize() first.
+    bool writeBinary(const std::string& path) const {
+        std::vector<cgfile::NodeEntry> entries;
+        entries.reserve(usrs.size());
+        std::string blob;
+        for (size_t i = 0; i < usrs.size(); ++i) {
+            cgfile::NodeEntry entry;
+            entry.usrOffset = static_cast<uint32_t>(blob.size());
+            entry.usrLength = static_cast<uint32_t>(usrs[i].size());
+            blob += usrs[i];
+            entry.nameOffset = static_cast<uint32_t>(blob.size());
+            entry.nameLength = static_cast<uint32_t>(names[i].size());
+            blob += names[i];
+            entries.push_back(entry);
+        }
+
+        cgfile::FileHeader h{};
+        std::memcpy(h.magic, cgfile::Magic, sizeof(h.magic));
+        h.nodeCount = static_cast<uint32_t>(usrs.size());
+        h.edgeCount = edges.size();
+        h.stringBytes = blob.size();
+
+        // Written under a temporary name and renamed, so a reader never maps a partial file.
+        const std::string tmp = path + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            if (!out) return false;
+            out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+            out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(cgfile::NodeEntry));
+            out.write(reinterpret_cast<const char*>(edges.data()), edges.size() * sizeof(cgfile::Edge));
+            out.write(blob.data(), blob.size());
+            if (!out) return false;
+        }
+        return std::rename(tmp.c_str(), path.c_str()) == 0;
+    }
+
+    // "caller -> callee" per edge, by display name.
+    void writeText(std::ostream& out) const {
+        for (const auto& e : edges) out << names[e.caller] << " -> " << names[e.callee] << "\n";
+    }
+
+    // Graphviz; nodes are labelled with their display names.
+    void writeDot(std::ostream& out) const {
+        out << "digraph callgraph {\n  node [shape=box];\n";
+        for (size_t i = 0; i < names.size(); ++i) out << "  n" << i << " [label=\"" << escape(names[i]) << "\"];\n";
+        for (const auto& e : edges) out << "  n" << e.caller << " -> n" << e.callee << ";\n";
+        out << "}\n";
+    }
+
+private:
+    static std::string escape(const std::string& s) {
+        std::string r;
+        for (char c : s) {
+            if (c == '"' || c == '\\') r += '\\';
+            r += c;
+        }
+        return r;
+    }
+
+    std::vector<std::string> usrs;
+    std::vector<std::string> names;
+    std::unordered_map<std::string, uint32_t> ids;
+    std::vector<cgfile::Edge> edges;
+};
+
+#endif // CALLGRAPH_STORE_HPP
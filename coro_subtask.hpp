@@ -0,0 +1,206 @@
+// coro_subtask.hpp
+#ifndef CORO_SUBTASK_HPP
+#define CORO_SUBTASK_HPP
+
+#include <coroutine>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <vector>
+#include <exception>
+#include <utility>
+
+#include "inplace_function.hpp"
+#include "work_stealing_pool.hpp"
+
+// Return type of a coroutine subtask:
+//
+//     SubTaskCoroutine fetch() {
+//         co_await sleepFor(std::chrono::milliseconds(50));
+//         ...
+//     }
+//
+// The coroutine is created suspended. start() runs it on the calling thread up to its first
+// suspension; whoever resumes it later runs the next stretch, and `done` runs on the thread
+// that executes its last step. The frame frees itself when the body returns.
+class SubTaskCoroutine {
+public:
+    struct promise_type {
+        InplaceFunction<void()> onDone;
+
+        // Not an aggregate, so the compiler never tries to build the promise from the
+        // coroutine's arguments.
+        promise_type() noexcept {}
+
+        SubTaskCoroutine get_return_object() {
+            return SubTaskCoroutine(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            void await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                auto done = std::move(h.promise().onDone);
+                h.destroy();
+                if (done) done();
+            }
+            void await_resume() noexcept {}
+        };
+
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        void return_void() {}
+
+        // Same as a throwing synchronous subtask, which takes its worker down.
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    SubTaskCoroutine(SubTaskCoroutine&& other) noexcept : coro(std::exchange(other.coro, nullptr)) {}
+
+    SubTaskCoroutine& operator=(SubTaskCoroutine&& other) noexcept {
+        if (this != &other) {
+            if (coro) coro.destroy();
+            coro = std::exchange(other.coro, nullptr);
+        }
+        return *this;
+    }
+
+    ~SubTaskCoroutine() {
+        if (coro) coro.destroy();
+    }
+
+    void start(InplaceFunction<void()> done) {
+        auto h = std::exchange(coro, nullptr);
+        h.promise().onDone = std::move(done);
+        h.resume();
+    }
+
+private:
+    explicit SubTaskCoroutine(std::coroutine_handle<promise_type> h) : coro(h) {}
+
+    std::coroutine_handle<promise_type> coro;
+};
+
+// One background thread that owns every pending timer and, when one expires, submits the
+// suspended coroutine back to the pool it was running on.
+class CoroutineTimer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static CoroutineTimer& instance() {
+        static CoroutineTimer timer;
+        return timer;
+    }
+
+    // The pool waits for the resumption before it shuts down.
+    void schedule(Clock::time_point deadline, std::coroutine_handle<> h, WorkStealingPool* pool) {
+        pool->expectSubmission();
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            timers.push(Entry{deadline, seq++, h, pool});
+        }
+        cv.notify_one();
+    }
+
+    ~CoroutineTimer() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        cv.notify_one();
+        thread.join();
+        // Still parked at exit: these coroutines never resume, but their pools may shut down.
+        for (; !timers.empty(); timers.pop()) timers.top().pool->cancelExpected();
+    }
+
+private:
+    struct Entry {
+        Clock::time_point deadline;
+        unsigned long long seq;  // FIFO among equal deadlines
+        std::coroutine_handle<> handle;
+        WorkStealingPool* pool;
+
+        bool operator>(const Entry& other) const {
+            return deadline != other.deadline ? deadline > other.deadline : seq > other.seq;
+        }
+    };
+
+    CoroutineTimer() : thread([this]() { run(); }) {}
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (!stopping) {
+            if (timers.empty()) {
+                cv.wait(lock);
+                continue;
+            }
+            const Clock::time_point next = timers.top().deadline;  // top() moves while we wait
+            if (Clock::now() < next) {
+                cv.wait_until(lock, next);
+                continue;
+            }
+            Entry due = timers.top();
+            timers.pop();
+            lock.unlock();
+            due.pool->submitExpected([h = due.handle]() { h.resume(); });
+            lock.lock();
+        }
+    }
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> timers;
+    unsigned long long seq = 0;
+    bool stopping = false;
+    std::thread thread;
+};
+
+// `co_await sleepUntil(t)` suspends without holding a thread and resumes on a worker of the
+// pool the coroutine was running on (the shared pool when awaited from any other thread).
+class SleepAwaiter {
+public:
+    explicit SleepAwaiter(CoroutineTimer::Clock::time_point deadline) : deadline(deadline) {}
+
+    bool await_ready() const { return CoroutineTimer::Clock::now() >= deadline; }
+
+    void await_suspend(std::coroutine_handle<> h) const {
+        WorkStealingPool* pool = WorkStealingPool::current();
+        CoroutineTimer::instance().schedule(deadline, h, pool ? pool : &WorkStealingPool::shared());
+    }
+
+    void await_resume() const {}
+
+private:
+    CoroutineTimer::Clock::time_point deadline;
+};
+
+inline SleepAwaiter sleepUntil(CoroutineTimer::Clock::time_point deadline) { return SleepAwaiter(deadline); }
+
+template <typename Rep, typename Period>
+SleepAwaiter sleepFor(std::chrono::duration<Rep, Period> d) {
+    return SleepAwaiter(CoroutineTimer::Clock::now() + std::chrono::duration_cast<CoroutineTimer::Clock::duration>(d));
+}
+
+// `co_await resumeOn(pool)` moves the rest of the coroutine onto the pool. Use it after an
+// awaitable that completes on a foreign thread (an I/O callback, say) so the subtask does
+// not keep running there.
+class ResumeOnAwaiter {
+public:
+    explicit ResumeOnAwaiter(WorkStealingPool& pool) : pool(pool) {}
+
+    bool await_ready() const { return WorkStealingPool::current() == &pool; }
+
+    void await_suspend(std::coroutine_handle<> h) const { pool.submit([h]() { h.resume(); }); }
+
+    void await_resume() const {}
+
+private:
+    WorkStealingPool& pool;
+};
+
+inline ResumeOnAwaiter resumeOn(WorkStealingPool& pool) { return ResumeOnAwaiter(pool); }
+
+#endif // CORO_SUBTASK_HPP
@@ -0,0 +1,77 @@
+// cost_model.hpp
+#ifndef COST_MODEL_HPP
+#define COST_MODEL_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// What a dispatch costs the virtual-clock engine on top of the burst itself. Costs are in
+// microseconds, well below the engine's 1ms tick, so each processor carries the fractional
+// remainder over to its next slice and the lost time adds up exactly over a run.
+//
+// The default (all zero) is the original free model. The real-thread engine already pays the
+// OS's actual costs and ignores this.
+struct CostModel {
+    long long switchUs = 0;     // Every dispatch: kernel entry, register and TLB state, ...
+    long long migrationUs = 0;  // Refilling a fully warm cache on a processor other than the last one
+    long long cacheHalfLifeMs = 0;  // Time away after which half that cache is evicted anyway; 0 never decays
+    bool adaptiveQuantum = false;   // See AdaptiveQuantum
+
+    bool free() const { return switchUs == 0 && migrationUs == 0; }
+
+    // Refill cost of moving a thread whose last slice ended awayMs ago. What has decayed would
+    // have to be refetched on the old processor too, so only the remaining warmth is lost.
+    double migrationCostUs(long long awayMs) const {
+        if (cacheHalfLifeMs <= 0) return static_cast<double>(migrationUs);
+        return migrationUs * std::exp2(-static_cast<double>(awayMs) / cacheHalfLifeMs);
+    }
+};
+
+// Sizes the base quantum from the bursts of recently completed threads: long enough for most
+// of them (80%) to finish in one slice, but at least 20 context switches long, so switching
+// costs no more than 5% of a slice. Policies still scale the base as before (MLFQ levels).
+class AdaptiveQuantum {
+public:
+    AdaptiveQuantum(int initialMs, long long switchUs, int maxMs = 10000)
+        : current(initialMs), lowest(initialMs), highest(initialMs), maxMs(maxMs),
+          minMs(static_cast<int>(std::max(1LL, (20 * switchUs + 999) / 1000))) {
+        window.reserve(Window);
+    }
+
+    int quantum() const { return current; }
+    int lowestQuantum() const { return lowest; }
+    int highestQuantum() const { return highest; }
+
+    void observe(int burstMs) {
+        if (window.size() < Window) {
+            window.push_back(burstMs);
+        } else {
+            window[observed % Window] = burstMs;
+        }
+        if (++observed % RecomputeEvery == 0) recompute();
+    }
+
+private:
+    static constexpr size_t Window = 256;       // Most recent completions considered
+    static constexpr long long RecomputeEvery = 32;
+
+    void recompute() {
+        std::vector<int> sorted = window;
+        auto at = sorted.begin() + (sorted.size() * 8 - 1) / 10;
+        std::nth_element(sorted.begin(), at, sorted.end());
+        current = std::clamp(*at, minMs, std::max(minMs, maxMs));
+        lowest = std::min(lowest, current);
+        highest = std::max(highest, current);
+    }
+
+    std::vector<int> window;
+    long long observed = 0;
+    int current;
+    int lowest;
+    int highest;
+    int maxMs;
+    int minMs;
+};
+
+#endif // COST_MODEL_HPP
@@ -0,0 +1,237 @@
+// cpu_topology.hpp
+#ifndef CPU_TOPOLOGY_HPP
+#define CPU_TOPOLOGY_HPP
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+
+// Where each worker of a pool runs. Worker i is pinned to cpus[i] (-1 leaves it to the OS)
+// and, when it runs out of work, tries the other workers in stealOrder[i]. Empty members keep
+// the defaults: unpinned, and stealing round robin from the next worker on.
+struct WorkerAffinity {
+    std::vector<int> cpus;
+    std::vector<std::vector<unsigned>> stealOrder;
+};
+
+// Pins the calling thread to one logical CPU; false if the OS refused (CPU offline, outside the
+// cgroup's cpuset) or this is not Linux.
+inline bool pinCurrentThread(int cpu) {
+#ifdef __linux__
+    if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+// The machine's logical CPUs as Linux describes them under /sys/devices/system/cpu: which
+// ones are SMT siblings of one physical core, which share a last-level cache, and which NUMA
+// node each belongs to. Only CPUs the process may run on are listed. Anything sysfs does not
+// say is filled in conservatively (own core, one LLC, node 0), so detect() always returns at
+// least one CPU.
+class CpuTopology {
+public:
+    struct Cpu {
+        int id;        // Logical CPU number, as used by sched_setaffinity
+        int core;      // Dense physical-core index; SMT siblings share it
+        int llc;       // Dense last-level-cache index
+        int node;      // NUMA node
+        int package;   // Socket
+        int smtIndex;  // 0 for the first hardware thread of its core, 1 for the next, ...
+    };
+
+    static CpuTopology detect(const std::string& root = "/sys/devices/system/cpu") {
+        CpuTopology t;
+        std::vector<int> ids = parseCpuList(readFile(root + "/online"));
+        if (ids.empty()) ids.push_back(0);
+        filterByAffinity(ids);
+
+        std::map<std::pair<int, int>, int> cores;  // (package, core_id) -> dense index
+        std::map<std::string, int> caches;         // shared_cpu_list -> dense index
+        for (int id : ids) {
+            const std::string dir = root + "/cpu" + std::to_string(id);
+            Cpu c{id, 0, 0, nodeOf(dir), 0, 0};
+            c.package = readInt(dir + "/topology/physical_package_id", 0);
+            const int coreId = readInt(dir + "/topology/core_id", id);
+            c.core = cores.emplace(std::make_pair(c.package, coreId), static_cast<int>(cores.size())).first->second;
+            c.llc = caches.emplace(lastLevelCache(dir), static_cast<int>(caches.size())).first->second;
+            t.cpus.push_back(c);
+        }
+
+        std::map<int, int> threadsSeen;
+        for (Cpu& c : t.cpus) c.smtIndex = threadsSeen[c.core]++;
+        return t;
+    }
+
+    const std::vector<Cpu>& all() const { return cpus; }
+
+    const Cpu* find(int id) const {
+        for (const Cpu& c : cpus) {
+            if (c.id == id) return &c;
+        }
+        return nullptr;
+    }
+
+    // CPUs for `workers` workers: one hardware thread per physical core before any SMT
+    // sibling, filling one LLC (then one NUMA node) before moving on, so neighbouring workers
+    // share a cache. More workers than CPUs wrap around.
+    std::vector<int> placement(unsigned workers) const {
+        std::vector<Cpu> order = cpus;
+        std::sort(order.begin(), order.end(), [](const Cpu& a, const Cpu& b) {
+            return std::tie(a.smtIndex, a.node, a.llc, a.core, a.id) < std::tie(b.smtIndex, b.node, b.llc, b.core, b.id);
+        });
+        std::vector<int> result;
+        for (unsigned i = 0; i < workers; ++i) result.push_back(order[i % order.size()].id);
+        return result;
+    }
+
+    // For each worker, every other worker ordered by how close its CPU is: SMT sibling, then
+    // shared LLC, then same NUMA node, then the rest. Ties keep the round-robin order starting
+    // after the thief, so thieves at the same distance do not all hit the same victim first.
+    std::vector<std::vector<unsigned>> stealOrder(const std::vector<int>& workerCpus) const {
+        const unsigned n = static_cast<unsigned>(workerCpus.size());
+        std::vector<std::vector<unsigned>> order(n);
+        for (unsigned i = 0; i < n; ++i) {
+            for (unsigned k = 1; k < n; ++k) order[i].push_back((i + k) % n);
+            std::stable_sort(order[i].begin(), order[i].end(), [&](unsigned a, unsigned b) {
+                return distance(workerCpus[i], workerCpus[a]) < distance(workerCpus[i], workerCpus[b]);
+            });
+        }
+        return order;
+    }
+
+    WorkerAffinity affinityFor(unsigned workers) const {
+        WorkerAffinity a;
+        a.cpus = placement(workers);
+        a.stealOrder = stealOrder(a.cpus);
+        return a;
+    }
+
+    // 0 same core, 1 same LLC, 2 same NUMA node, 3 anything else (or unknown).
+    int distance(int cpuA, int cpuB) const {
+        const Cpu* a = find(cpuA);
+        const Cpu* b = find(cpuB);
+        if (!a || !b) return 3;
+        if (a->core == b->core) return 0;
+        if (a->llc == b->llc) return 1;
+        if (a->node == b->node) return 2;
+        return 3;
+    }
+
+    // "cpu 3 (core 1, llc 0, node 0)"
+    std::string describe(int id) const {
+        const Cpu* c = find(id);
+        if (!c) return "cpu " + std::to_string(id);
+        return "cpu " + std::to_string(c->id) + " (core " + std::to_string(c->core) + ", llc " +
+               std::to_string(c->llc) + ", node " + std::to_string(c->node) + ")";
+    }
+
+    // One line per LLC: its CPUs and node.
+    std::string summary() const {
+        std::map<int, std::vector<const Cpu*>> byLlc;
+        for (const Cpu& c : cpus) byLlc[c.llc].push_back(&c);
+        std::ostringstream out;
+        for (const auto& [llc, members] : byLlc) {
+            out << "LLC " << llc << " (node " << members.front()->node << "):";
+            for (const Cpu* c : members) out << " " << c->id << (c->smtIndex ? "*" : "");
+            out << "\n";
+        }
+        return out.str();
+    }
+
+    // "0-3,8,10-11" -> {0, 1, 2, 3, 8, 10, 11}
+    static std::vector<int> parseCpuList(const std::string& list) {
+        std::vector<int> ids;
+        std::istringstream in(list);
+        std::string range;
+        while (std::getline(in, range, ',')) {
+            if (range.empty() || range.find_first_not_of(" \n") == std::string::npos) continue;
+            const size_t dash = range.find('-');
+            const int first = std::atoi(range.c_str());
+            const int last = dash == std::string::npos ? first : std::atoi(range.c_str() + dash + 1);
+            for (int id = first; id <= last; ++id) ids.push_back(id);
+        }
+        return ids;
+    }
+
+private:
+    static std::string readFile(const std::string& path) {
+        std::ifstream in(path);
+        std::string text;
+        std::getline(in, text);
+        return text;
+    }
+
+    static int readInt(const std::string& path, int fallback) {
+        const std::string text = readFile(path);
+        return text.empty() ? fallback : std::atoi(text.c_str());
+    }
+
+    static void filterByAffinity(std::vector<int>& ids) {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) != 0) return;
+        std::vector<int> allowed;
+        for (int id : ids) {
+            if (id < CPU_SETSIZE && CPU_ISSET(id, &set)) allowed.push_back(id);
+        }
+        if (!allowed.empty()) ids.swap(allowed);
+#else
+        (void)ids;
+#endif
+    }
+
+    // cpuN/nodeM is a symlink to the CPU's NUMA node.
+    static int nodeOf(const std::string& cpuDir) {
+        int node = 0;
+        if (DIR* d = opendir(cpuDir.c_str())) {
+            while (dirent* e = readdir(d)) {
+                if (std::strncmp(e->d_name, "node", 4) == 0 && e->d_name[4] >= '0' && e->d_name[4] <= '9') {
+                    node = std::atoi(e->d_name + 4);
+                    break;
+                }
+            }
+            closedir(d);
+        }
+        return node;
+    }
+
+    // The CPUs sharing the highest-level data or unified cache; "" (one shared LLC) if the
+    // kernel exposes no cache information.
+    static std::string lastLevelCache(const std::string& cpuDir) {
+        int bestLevel = -1;
+        std::string shared;
+        for (int index = 0;; ++index) {
+            const std::string dir = cpuDir + "/cache/index" + std::to_string(index);
+            const std::string level = readFile(dir + "/level");
+            if (level.empty()) break;
+            if (readFile(dir + "/type") == "Instruction") continue;
+            if (std::atoi(level.c_str()) > bestLevel) {
+                bestLevel = std::atoi(level.c_str());
+                shared = readFile(dir + "/shared_cpu_list");
+            }
+        }
+        return shared;
+    }
+
+    std::vector<Cpu> cpus;
+};
+
+#endif // CPU_TOPOLOGY_HPP
@@ -12,85 +12,526 @@
 #include <atomic>
 #include <unordered_map>
 #include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <algorithm>
 
+#include "inplace_function.hpp"
+#include "work_stealing_pool.hpp"
+#include "coro_subtask.hpp"
+#include "trace.hpp"
+
+// Move-only; the DAG takes ownership of the work and discards the dependency list once it
+// has been folded into the DAG's own successor arrays.
+//
+// A subtask has either `work`, which runs to completion on one worker, or `coroutine`, a
+// factory for a coroutine that may co_await timers or other awaitables. While a coroutine
+// subtask is suspended its worker runs other subtasks, and the subtask only counts as complete
+// (releasing its successors) when the coroutine body returns. The graph keeps the factory alive
+// for the whole run, so a capturing lambda coroutine may use its captures.
 struct SubTask {
+    using Work = InplaceFunction<void()>;
+    using Coroutine = InplaceFunction<SubTaskCoroutine()>;
+
+    int id;
+    Work work;
+    std::vector<int> dependencies;
+    double cost = 1.0;  // Estimated run time, in any consistent unit; drives rank-based ordering
+    Coroutine coroutine;
+};
+
+// Like SubTask, but the work receives the context pointer of the run that executes it, so one
+// compiled graph can serve many concurrent runs over different data.
+struct ContextSubTask {
+    using Work = InplaceFunction<void(void* context), 64>;
+    using Coroutine = InplaceFunction<SubTaskCoroutine(void* context), 64>;
+
     int id;
-    std::function<void()> work;
+    Work work;
     std::vector<int> dependencies;
+    double cost = 1.0;
+    Coroutine coroutine;
+};
+
+// Timing of one DAG run. Estimates are in SubTask::cost units, measurements in ms.
+struct DAGRunReport {
+    double estimatedCriticalPath = 0;  // Largest upward rank
+    double plannedMakespan = 0;        // HEFT's estimate; 0 unless HEFT placement was used
+    double criticalPathMs = 0;         // Longest dependency chain of measured subtask times
+    double totalWorkMs = 0;
+    double makespanMs = 0;
+    unsigned workers = 0;
+
+    // 1.0 means the run finished as soon as its critical path allowed.
+    double efficiency() const { return makespanMs > 0 ? criticalPathMs / makespanMs : 0.0; }
+
+    // Fraction of worker time spent running subtasks.
+    double utilization() const {
+        return makespanMs > 0 && workers > 0 ? totalWorkMs / (makespanMs * workers) : 0.0;
+    }
+};
+
+// A validated DAG laid out for execution: dense node indices, CSR successor lists, initial
+// indegrees, topological order and upward ranks. It is built once and shared read-only by any
+// number of DAGSchedulers, each of which only keeps the per-run counters.
+class CompiledDAG {
+public:
+    using Kernel = ContextSubTask::Work;
+    using CoroutineKernel = ContextSubTask::Coroutine;
+
+    struct HeftPlan {
+        unsigned workers;
+        std::vector<int> placement;  // Worker per node
+        double makespan;             // In cost units
+    };
+
+    // Throws std::invalid_argument on duplicate ids, unknown dependency ids or cycles, any of
+    // which would otherwise leave a run waiting forever, and on a subtask with neither work
+    // nor a coroutine, which would fail on a worker thread.
+    explicit CompiledDAG(std::vector<SubTask> taskList) {
+        nodes.reserve(taskList.size());
+        for (auto& t : taskList) {
+            Node node{t.id, t.cost, nullptr, nullptr};
+            if (t.coroutine) {
+                node.coroutine = [factory = std::move(t.coroutine)](void*) { return factory(); };
+            } else if (t.work) {
+                node.work = [work = std::move(t.work)](void*) { work(); };
+            }
+            nodes.push_back(std::move(node));
+        }
+        build(taskList);
+    }
+
+    explicit CompiledDAG(std::vector<ContextSubTask> taskList) {
+        nodes.reserve(taskList.size());
+        for (auto& t : taskList) nodes.push_back(Node{t.id, t.cost, std::move(t.work), std::move(t.coroutine)});
+        build(taskList);
+    }
+
+    CompiledDAG(const CompiledDAG&) = delete;
+    CompiledDAG& operator=(const CompiledDAG&) = delete;
+
+    int size() const { return static_cast<int>(nodes.size()); }
+    int idOf(int node) const { return nodes[node].id; }
+    double costOf(int node) const { return nodes[node].cost; }
+
+    // Concurrent runs may call the same kernel at once, so kernels must not mutate their captures
+    // unless they synchronise themselves.
+    void run(int node, void* context) const { nodes[node].work(context); }
+
+    bool isCoroutine(int node) const { return static_cast<bool>(nodes[node].coroutine); }
+    SubTaskCoroutine createCoroutine(int node, void* context) const { return nodes[node].coroutine(context); }
+
+    const int* successorsBegin(int node) const { return succ.data() + succOffset[node]; }
+    const int* successorsEnd(int node) const { return succ.data() + succOffset[node + 1]; }
+    int initialIndegree(int node) const { return indegree[node]; }
+    const std::vector<int>& roots() const { return rootList; }
+    const std::vector<int>& topologicalOrder() const { return topoOrder; }
+
+    double criticalPath() const { return rank.empty() ? 0.0 : *std::max_element(rank.begin(), rank.end()); }
+
+    // Replaces the cost estimates (indexed by node) and recomputes the ranks. No run of this
+    // graph may be in flight.
+    void setCosts(const std::vector<double>& costs) {
+        for (int i = 0; i < size(); ++i) nodes[i].cost = costs[i];
+        computeRanks();
+        std::lock_guard<std::mutex> lock(planMtx);
+        plan.reset();
+    }
+
+    // HEFT schedule for a pool of the given size, computed on first use and cached.
+    std::shared_ptr<const HeftPlan> heftPlan(unsigned workers) const {
+        std::lock_guard<std::mutex> lock(planMtx);
+        if (!plan || plan->workers != workers) plan = std::make_shared<const HeftPlan>(planHeft(workers));
+        return plan;
+    }
+
+private:
+    struct Node {
+        int id;
+        double cost;
+        Kernel work;
+        CoroutineKernel coroutine;  // Set instead of work for coroutine subtasks
+    };
+
+    template <typename Spec>
+    void build(const std::vector<Spec>& taskList) {
+        const int n = size();
+
+        std::unordered_map<int, int> index;
+        index.reserve(n);
+        for (int i = 0; i < n; ++i) {
+            if (!index.emplace(nodes[i].id, i).second) {
+                throw std::invalid_argument("duplicate subtask id " + std::to_string(nodes[i].id));
+            }
+            if (!nodes[i].work && !nodes[i].coroutine) {
+                throw std::invalid_argument("subtask " + std::to_string(nodes[i].id) + " has no work");
+            }
+        }
+
+        indegree.assign(n, 0);
+        std::vector<int> parents;
+        succOffset.assign(n + 1, 0);
+        for (int i = 0; i < n; ++i) {
+            for (int dep : taskList[i].dependencies) {
+                auto it = index.find(dep);
+                if (it == index.end()) {
+                    throw std::invalid_argument("subtask " + std::to_string(nodes[i].id) +
+                                                " depends on unknown subtask " + std::to_string(dep));
+                }
+                parents.push_back(it->second);
+                ++succOffset[it->second + 1];
+                ++indegree[i];
+            }
+        }
+        for (int i = 0; i < n; ++i) succOffset[i + 1] += succOffset[i];
+
+        succ.resize(succOffset[n]);
+        std::vector<int> cursor(succOffset.begin(), succOffset.end() - 1);
+        size_t p = 0;
+        for (int i = 0; i < n; ++i) {
+            for (size_t k = 0; k < taskList[i].dependencies.size(); ++k) {
+                succ[cursor[parents[p++]]++] = i;
+            }
+        }
+
+        for (int i = 0; i < n; ++i) {
+            if (indegree[i] == 0) rootList.push_back(i);
+        }
+
+        topoOrder = sortTopologically();
+        computeRanks();
+    }
+
+    // Kahn's algorithm over a scratch copy of the indegrees; throws on a cycle.
+    std::vector<int> sortTopologically() const {
+        std::vector<int> degree(indegree);
+        std::vector<int> order;
+        order.reserve(size());
+        std::vector<int> stack(rootList);
+        while (!stack.empty()) {
+            int node = stack.back();
+            stack.pop_back();
+            order.push_back(node);
+            for (int k = succOffset[node]; k < succOffset[node + 1]; ++k) {
+                if (--degree[succ[k]] == 0) stack.push_back(succ[k]);
+            }
+        }
+        if (static_cast<int>(order.size()) == size()) return order;
+
+        for (int i = 0; i < size(); ++i) {
+            if (degree[i] > 0) {
+                throw std::invalid_argument("dependency cycle involving subtask " +
+                                            std::to_string(nodes[i].id));
+            }
+        }
+        return order;
+    }
+
+    // Upward ranks, then every successor list and the root list sorted by ascending rank.
+    // A completing subtask releases its children in that order onto its own deque, so the
+    // child on the critical path is pushed last and popped first, while thieves take the
+    // least critical work from the other end.
+    void computeRanks() {
+        rank.assign(size(), 0.0);
+        for (auto it = topoOrder.rbegin(); it != topoOrder.rend(); ++it) {
+            double longest = 0.0;
+            for (int k = succOffset[*it]; k < succOffset[*it + 1]; ++k) longest = std::max(longest, rank[succ[k]]);
+            rank[*it] = nodes[*it].cost + longest;
+        }
+
+        auto byRank = [this](int a, int b) { return rank[a] < rank[b]; };
+        for (int i = 0; i < size(); ++i) {
+            std::stable_sort(succ.begin() + succOffset[i], succ.begin() + succOffset[i + 1], byRank);
+        }
+        std::stable_sort(rootList.begin(), rootList.end(), byRank);
+    }
+
+    // HEFT for identical workers: visit subtasks by decreasing upward rank and put each on the
+    // worker where it would finish earliest, filling idle gaps (insertion policy).
+    HeftPlan planHeft(unsigned numWorkers) const {
+        std::vector<int> order(topoOrder);
+        std::stable_sort(order.begin(), order.end(), [this](int a, int b) { return rank[a] > rank[b]; });
+
+        std::vector<std::vector<std::pair<double, double>>> busy(numWorkers);  // Sorted (start, finish)
+        std::vector<double> readyAt(size(), 0.0);
+        HeftPlan result{numWorkers, std::vector<int>(size(), 0), 0.0};
+
+        for (int node : order) {
+            const double cost = nodes[node].cost;
+            double bestFinish = 0.0;
+            unsigned bestWorker = 0;
+            size_t bestSlot = 0;
+
+            for (unsigned w = 0; w < numWorkers; ++w) {
+                double start = readyAt[node];
+                size_t slot = 0;
+                for (; slot < busy[w].size(); ++slot) {
+                    if (start + cost <= busy[w][slot].first) break;
+                    start = std::max(start, busy[w][slot].second);
+                }
+                if (w == 0 || start + cost < bestFinish) {
+                    bestFinish = start + cost;
+                    bestWorker = w;
+                    bestSlot = slot;
+                }
+            }
+
+            busy[bestWorker].insert(busy[bestWorker].begin() + bestSlot, {bestFinish - cost, bestFinish});
+            result.placement[node] = static_cast<int>(bestWorker);
+            result.makespan = std::max(result.makespan, bestFinish);
+            for (int k = succOffset[node]; k < succOffset[node + 1]; ++k) {
+                readyAt[succ[k]] = std::max(readyAt[succ[k]], bestFinish);
+            }
+        }
+        return result;
+    }
+
+    // Subtasks are remapped to dense indices 0..n-1 (input order).
+    std::vector<Node> nodes;
+    // CSR successor lists: the children of node i are succ[succOffset[i] .. succOffset[i + 1]).
+    std::vector<int> succOffset;
+    std::vector<int> succ;
+    std::vector<int> indegree;
+    std::vector<int> rootList;
+    std::vector<int> topoOrder;
+    std::vector<double> rank;  // Upward rank: cost of the longest path from the node to an exit
+
+    mutable std::mutex planMtx;
+    mutable std::shared_ptr<const HeftPlan> plan;
 };
 
+// Body of a dispatched subtask, shared by DAGScheduler and StreamingDAG. Plain work runs inline;
+// otherwise makeCoroutine() creates the coroutine and it is started here. A coroutine may finish
+// on another worker, so it is traced as an async span. Either way finished(started) is called
+// once the subtask is over; it must be small enough to ride along in the coroutine's callback.
+// traceScope tells this run's coroutine spans from those of other runs with the same ids.
+template <typename Work, typename MakeCoroutine, typename Finished>
+void runSubtaskJob(int id, uint32_t traceScope, bool verbose, bool isCoroutine, Work&& work,
+                   MakeCoroutine&& makeCoroutine, Finished finished) {
+    const int worker = WorkStealingPool::currentWorker();
+    if (verbose) std::cout << "Subtask " << id << " started\n";
+    auto started = std::chrono::steady_clock::now();
+
+    if (isCoroutine) {
+        Tracer::emit(TraceEvent::CoroutineBegin, worker, id, traceScope);
+        makeCoroutine().start([id, traceScope, finished, started]() {
+            Tracer::emit(TraceEvent::CoroutineEnd, WorkStealingPool::currentWorker(), id, traceScope);
+            finished(started);
+        });
+        return;
+    }
+
+    Tracer::emit(TraceEvent::SubtaskBegin, worker, id);
+    work();
+    Tracer::emit(TraceEvent::SubtaskEnd, worker, id);
+    finished(started);
+}
+
+// One executable instance of a CompiledDAG. It owns only the per-run state, so constructing one
+// over an existing graph is a single allocation, and a finished run can be started again after
+// an O(n) counter reset.
 class DAGScheduler {
+public:
+    // WorkStealing: a subtask runs on the worker that released it unless another worker steals it.
+    // HEFT: subtasks are pre-assigned to workers by a HEFT list schedule over their costs
+    // (homogeneous workers, no communication cost) and pinned to that worker: no other worker
+    // steals them, so the run follows the plan that plannedMakespan describes.
+    enum class Placement { WorkStealing, HEFT };
+
 private:
-    std::unordered_map<int, SubTask> subtasks;
-    std::unordered_map<int, int> indegree;
-    std::unordered_map<int, std::vector<int>> graph;
+    struct NodeState {
+        std::atomic<int> indegree{0};
+        double measuredMs = 0;  // Written once per run by the worker that ran the node
+        double longestMs = 0;   // Scratch for the measured critical path
+    };
+
+    std::shared_ptr<CompiledDAG> graph;
+    std::unique_ptr<NodeState[]> state;
+    void* context;
+    std::shared_ptr<const CompiledDAG::HeftPlan> plan;  // Set for HEFT runs only
+    Placement placementMode = Placement::WorkStealing;
+    DAGRunReport lastRun;
+    std::chrono::steady_clock::time_point runStart;
+    uint32_t traceScope = 0;
+
     std::mutex mtx;
     std::condition_variable cv;
     std::atomic<int> completed{0};
     int total;
+    int capacity;  // Nodes `state` has room for
+    bool finished = false;
+    bool verbose = true;  // Per-subtask console output
+    WorkStealingPool* pool = nullptr;
+    SubTask::Work onComplete;
 
 public:
-    DAGScheduler(const std::vector<SubTask>& taskList) {
-        total = taskList.size();
-        for (const auto& task : taskList) {
-            subtasks[task.id] = task;
-            indegree[task.id] = task.dependencies.size();
-            for (int dep : task.dependencies) {
-                graph[dep].push_back(task.id);
-            }
+    // Compiles a private graph; throws like CompiledDAG.
+    explicit DAGScheduler(std::vector<SubTask> taskList)
+        : DAGScheduler(std::make_shared<CompiledDAG>(std::move(taskList))) {}
+
+    // A run of a shared graph. Every subtask's work receives `context`.
+    explicit DAGScheduler(std::shared_ptr<CompiledDAG> compiled, void* context = nullptr)
+        : graph(std::move(compiled)), state(new NodeState[graph->size()]), context(context),
+          total(graph->size()), capacity(total) {}
+
+    void setVerbose(bool v) { verbose = v; }
+
+    // Runs another graph from the next run on, so a finished scheduler can be recycled. The
+    // per-node state is only reallocated for a graph larger than any it has run before.
+    void setGraph(std::shared_ptr<CompiledDAG> compiled) {
+        if (compiled->size() > capacity) {
+            state.reset(new NodeState[compiled->size()]);
+            capacity = compiled->size();
         }
+        graph = std::move(compiled);
+        total = graph->size();
+    }
+
+    void setPlacement(Placement mode) { placementMode = mode; }
+
+    // Context pointer for the next run.
+    void setContext(void* ctx) { context = ctx; }
+
+    const CompiledDAG& compiled() const { return *graph; }
+
+    // Replaces the graph's cost estimates with the times measured in the last run. This changes
+    // the shared graph, so no other run of it may be in flight.
+    void useMeasuredCosts() {
+        std::vector<double> costs(total);
+        for (int i = 0; i < total; ++i) costs[i] = state[i].measuredMs;
+        graph->setCosts(costs);
     }
 
+    // Valid once execute() has returned, or inside the executeAsync() completion callback.
+    const DAGRunReport& report() const { return lastRun; }
+
+    // Runs the DAG on the process-wide worker pool and blocks until every subtask has finished.
     void execute() {
-        std::queue<int> readyQueue;
+        execute(WorkStealingPool::shared());
+    }
 
-        for (const auto& [id, degree] : indegree) {
-            if (degree == 0) readyQueue.push(id);
+    // Subtasks are dispatched onto the pool the moment their last dependency completes,
+    // so a slow subtask only delays its own successors. Blocks the calling thread, so it must
+    // not be called from one of the pool's own workers; use executeAsync() there.
+    // May be called again once the previous run has finished.
+    void execute(WorkStealingPool& workers) {
+        if (total == 0) return;
+        start(workers);
+
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [this]() { return finished; });
+    }
+
+    // Starts the DAG on the pool and returns immediately. `done` runs on the worker that finishes
+    // the last subtask; it may destroy this scheduler or start it again.
+    void executeAsync(WorkStealingPool& workers, SubTask::Work done) {
+        if (total == 0) {
+            done();
+            return;
         }
+        onComplete = std::move(done);
+        start(workers);
+    }
 
-        while (completed < total) {
-            std::vector<std::thread> threads;
-            std::vector<int> currentBatch;
+private:
+    void start(WorkStealingPool& workers) {
+        for (int i = 0; i < total; ++i) state[i].indegree.store(graph->initialIndegree(i), std::memory_order_relaxed);
+        completed.store(0, std::memory_order_relaxed);
+        finished = false;
 
-            {
-                std::unique_lock<std::mutex> lock(mtx);
-                while (!readyQueue.empty()) {
-                    currentBatch.push_back(readyQueue.front());
-                    readyQueue.pop();
-                }
-            }
+        pool = &workers;
+        lastRun = DAGRunReport{};
+        lastRun.estimatedCriticalPath = graph->criticalPath();
+        lastRun.workers = workers.size();
+        if (placementMode == Placement::HEFT) {
+            plan = graph->heftPlan(workers.size());
+            lastRun.plannedMakespan = plan->makespan;
+        } else {
+            plan.reset();
+        }
+        runStart = std::chrono::steady_clock::now();
+        traceScope = Tracer::newScope();
 
-            for (int id : currentBatch) {
-                threads.emplace_back([this, id]() {
-                    std::cout << "Subtask " << id << " started\n";
-                    subtasks[id].work();
-                    std::cout << "Subtask " << id << " finished\n";
-                    this->onTaskComplete(id);
-                });
-            }
+        // The submit below publishes the counters to the workers.
+        for (int node : graph->roots()) dispatch(node);
+    }
+
+    void dispatch(int node) {
+        auto job = [this, node]() {
+            runSubtaskJob(
+                graph->idOf(node), traceScope, verbose, graph->isCoroutine(node),
+                [this, node]() { graph->run(node, context); },
+                [this, node]() { return graph->createCoroutine(node, context); },
+                [this, node](std::chrono::steady_clock::time_point started) { this->finishSubtask(node, started); });
+        };
+        if (!plan) {
+            pool->submit(std::move(job));
+        } else {
+            pool->submitPinned(plan->placement[node], std::move(job));
+        }
+    }
 
-            for (auto& t : threads) {
-                if (t.joinable()) t.join();
+    void finishSubtask(int node, std::chrono::steady_clock::time_point started) {
+        state[node].measuredMs = std::chrono::duration<double, std::milli>(
+                                     std::chrono::steady_clock::now() - started).count();
+        if (verbose) std::cout << "Subtask " << graph->idOf(node) << " finished\n";
+        onTaskComplete(node);
+    }
+
+    // Runs on the worker that completes the last subtask, before anyone is told the run is over.
+    void finishReport() {
+        lastRun.makespanMs = std::chrono::duration<double, std::milli>(
+                                 std::chrono::steady_clock::now() - runStart).count();
+        const auto& order = graph->topologicalOrder();
+        for (auto it = order.rbegin(); it != order.rend(); ++it) {
+            double tail = 0.0;
+            for (const int* c = graph->successorsBegin(*it); c != graph->successorsEnd(*it); ++c) {
+                tail = std::max(tail, state[*c].longestMs);
             }
+            NodeState& s = state[*it];
+            s.longestMs = s.measuredMs + tail;
+            lastRun.totalWorkMs += s.measuredMs;
+            lastRun.criticalPathMs = std::max(lastRun.criticalPathMs, s.longestMs);
         }
     }
 
-    void onTaskComplete(int id) {
-        std::unique_lock<std::mutex> lock(mtx);
-        for (int child : graph[id]) {
-            indegree[child]--;
-            if (indegree[child] == 0) {
-                cv.notify_all();
+    // Lock-free: whichever parent drops a child's indegree to zero dispatches it.
+    void onTaskComplete(int node) {
+        for (const int* c = graph->successorsBegin(node); c != graph->successorsEnd(node); ++c) {
+            if (state[*c].indegree.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                dispatch(*c);
             }
         }
-        completed++;
+
+        // Once the last completion is counted the scheduler may be destroyed, so nothing
+        // may be read from it after the fetch_add except by the thread that made it last.
+        const int n = total;
+        if (completed.fetch_add(1, std::memory_order_acq_rel) + 1 != n) return;
+
+        finishReport();
+        if (onComplete) {
+            auto done = std::move(onComplete);
+            done();
+            return;
+        }
+
+        // The waiter in execute() only returns once it sees `finished` under the lock.
+        std::lock_guard<std::mutex> lock(mtx);
+        finished = true;
+        cv.notify_all();
     }
 };
 
+// Waits 100 + id * 50 ms on a timer, without holding a worker while it waits.
 inline SubTask createSubTask(int id, std::vector<int> dependencies) {
-    return SubTask{id, [id]() {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100 + id * 50));
-    }, dependencies};
+    const int durationMs = 100 + id * 50;
+    SubTask t{id, nullptr, std::move(dependencies), static_cast<double>(durationMs), nullptr};
+    t.coroutine = [durationMs]() -> SubTaskCoroutine {
+        co_await sleepFor(std::chrono::milliseconds(durationMs));
+    };
+    return t;
 }
 
 #endif // DAG_SCHEDULER_HPP
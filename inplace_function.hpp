@@ -0,0 +1,108 @@
+// inplace_function.hpp
+#ifndef INPLACE_FUNCTION_HPP
+#define INPLACE_FUNCTION_HPP
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template <typename Signature, size_t Capacity = 48>
+class InplaceFunction;
+
+// Move-only replacement for std::function. Callables of up to Capacity bytes (with at most
+// max_align_t alignment and a noexcept move) are stored inside the object, so constructing,
+// moving and invoking them never allocates; larger ones fall back to a single heap block.
+template <typename R, typename... Args, size_t Capacity>
+class InplaceFunction<R(Args...), Capacity> {
+public:
+    InplaceFunction() noexcept = default;
+    InplaceFunction(std::nullptr_t) noexcept {}
+
+    template <typename F, typename Fn = std::decay_t<F>,
+              typename = std::enable_if_t<!std::is_same<Fn, InplaceFunction>::value &&
+                                          std::is_invocable_r<R, Fn&, Args...>::value>>
+    InplaceFunction(F&& f) {
+        if constexpr (fitsInline<Fn>()) {
+            new (&storage) Fn(std::forward<F>(f));
+            ops = &inlineOps<Fn>;
+        } else {
+            *reinterpret_cast<Fn**>(&storage) = new Fn(std::forward<F>(f));
+            ops = &heapOps<Fn>;
+        }
+    }
+
+    InplaceFunction(InplaceFunction&& other) noexcept { moveFrom(other); }
+
+    InplaceFunction& operator=(InplaceFunction&& other) noexcept {
+        if (this != &other) {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    InplaceFunction& operator=(std::nullptr_t) noexcept {
+        reset();
+        return *this;
+    }
+
+    InplaceFunction(const InplaceFunction&) = delete;
+    InplaceFunction& operator=(const InplaceFunction&) = delete;
+
+    ~InplaceFunction() { reset(); }
+
+    explicit operator bool() const noexcept { return ops != nullptr; }
+
+    // Const like std::function's: calling through a const reference may still run a mutable callable.
+    R operator()(Args... args) const { return ops->invoke(&storage, std::forward<Args>(args)...); }
+
+    // True when a callable of type F would be stored without allocating.
+    template <typename F>
+    static constexpr bool fitsInline() {
+        return sizeof(F) <= Capacity && alignof(F) <= alignof(std::max_align_t) &&
+               std::is_nothrow_move_constructible<F>::value;
+    }
+
+private:
+    struct Ops {
+        R (*invoke)(void*, Args&&...);
+        void (*move)(void* to, void* from) noexcept;  // Leaves `from` destroyed
+        void (*destroy)(void*) noexcept;
+    };
+
+    template <typename Fn>
+    static constexpr Ops inlineOps = {
+        [](void* s, Args&&... args) -> R { return (*static_cast<Fn*>(s))(std::forward<Args>(args)...); },
+        [](void* to, void* from) noexcept {
+            new (to) Fn(std::move(*static_cast<Fn*>(from)));
+            static_cast<Fn*>(from)->~Fn();
+        },
+        [](void* s) noexcept { static_cast<Fn*>(s)->~Fn(); },
+    };
+
+    template <typename Fn>
+    static constexpr Ops heapOps = {
+        [](void* s, Args&&... args) -> R { return (**static_cast<Fn**>(s))(std::forward<Args>(args)...); },
+        [](void* to, void* from) noexcept { *static_cast<Fn**>(to) = *static_cast<Fn**>(from); },
+        [](void* s) noexcept { delete *static_cast<Fn**>(s); },
+    };
+
+    void moveFrom(InplaceFunction& other) noexcept {
+        if (!other.ops) return;
+        other.ops->move(&storage, &other.storage);
+        ops = other.ops;
+        other.ops = nullptr;
+    }
+
+    void reset() noexcept {
+        if (!ops) return;
+        ops->destroy(&storage);
+        ops = nullptr;
+    }
+
+    mutable std::aligned_storage_t<(Capacity < sizeof(void*) ? sizeof(void*) : Capacity), alignof(std::max_align_t)> storage;
+    const Ops* ops = nullptr;
+};
+
+#endif // INPLACE_FUNCTION_HPP
@@ -0,0 +1,188 @@
+// mpmc_queue.hpp
+#ifndef MPMC_QUEUE_HPP
+#define MPMC_QUEUE_HPP
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <cstddef>
+
+// Bounded multi-producer / multi-consumer ring (Vyukov's sequence-numbered cells).
+// The try_* operations are lock-free. The blocking push/pop only take a mutex to sleep
+// when the ring is full (producer backpressure) or empty.
+template <typename T>
+class BoundedMPMCQueue {
+public:
+    // Capacity is rounded up to a power of two.
+    explicit BoundedMPMCQueue(size_t capacity = 1024) {
+        size_t cap = 2;
+        while (cap < capacity) cap <<= 1;
+        mask = cap - 1;
+        cells.reset(new Cell[cap]);
+        for (size_t i = 0; i < cap; ++i) cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    BoundedMPMCQueue(const BoundedMPMCQueue&) = delete;
+    BoundedMPMCQueue& operator=(const BoundedMPMCQueue&) = delete;
+
+    size_t capacity() const { return mask + 1; }
+
+    bool try_push(T&& value) { return try_push_bulk(&value, 1) == 1; }
+
+    bool try_pop(T& value) { return try_pop_bulk(&value, 1) == 1; }
+
+    // Claims up to n consecutive free cells with a single CAS and moves items[0..k) into them.
+    size_t try_push_bulk(T* items, size_t n) {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            size_t ready = 0;
+            while (ready < n && cellSeq(pos + ready) == pos + ready) ++ready;
+            if (ready == 0) {
+                // Either full, or another producer moved enqueuePos past us.
+                size_t current = enqueuePos.load(std::memory_order_relaxed);
+                if (current == pos) return 0;
+                pos = current;
+                continue;
+            }
+            if (enqueuePos.compare_exchange_weak(pos, pos + ready, std::memory_order_relaxed)) {
+                for (size_t k = 0; k < ready; ++k) {
+                    Cell& cell = cells[(pos + k) & mask];
+                    cell.value = std::move(items[k]);
+                    cell.seq.store(pos + k + 1, std::memory_order_release);
+                }
+                wake(notEmptyWaiters, notEmpty, ready);
+                return ready;
+            }
+        }
+    }
+
+    // Claims up to n consecutive published cells with a single CAS and moves them into out[0..k).
+    size_t try_pop_bulk(T* out, size_t n) {
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        while (true) {
+            size_t ready = 0;
+            while (ready < n && cellSeq(pos + ready) == pos + ready + 1) ++ready;
+            if (ready == 0) {
+                size_t current = dequeuePos.load(std::memory_order_relaxed);
+                if (current == pos) return 0;
+                pos = current;
+                continue;
+            }
+            if (dequeuePos.compare_exchange_weak(pos, pos + ready, std::memory_order_relaxed)) {
+                for (size_t k = 0; k < ready; ++k) {
+                    Cell& cell = cells[(pos + k) & mask];
+                    out[k] = std::move(cell.value);
+                    cell.seq.store(pos + k + mask + 1, std::memory_order_release);
+                }
+                wake(notFullWaiters, notFull, ready);
+                return ready;
+            }
+        }
+    }
+
+    // Blocks while the ring is full. Returns false if the queue was closed first.
+    bool push(T&& value) { return push_bulk(&value, 1) == 1; }
+
+    // Pushes all n items, blocking whenever the ring is full; returns how many were pushed
+    // before the queue was closed.
+    size_t push_bulk(T* items, size_t n) {
+        size_t pushed = 0;
+        while (pushed < n) {
+            size_t k = try_push_bulk(items + pushed, n - pushed);
+            if (k > 0) {
+                pushed += k;
+                continue;
+            }
+            if (!waitFor(notFullWaiters, notFull, [this]() { return sizeApprox() < capacity(); }))
+                break;
+        }
+        return pushed;
+    }
+
+    // Blocks until an item is available. Returns false once the queue is closed and drained.
+    bool pop(T& value) { return pop_bulk(&value, 1) == 1; }
+
+    // Blocks until at least one item is available, then takes up to n. Returns 0 once the
+    // queue is closed and drained.
+    size_t pop_bulk(T* out, size_t n) {
+        while (true) {
+            size_t k = try_pop_bulk(out, n);
+            if (k > 0) return k;
+            if (!waitFor(notEmptyWaiters, notEmpty, [this]() { return sizeApprox() > 0; }))
+                return try_pop_bulk(out, n);
+        }
+    }
+
+    // Wakes every blocked producer and consumer. Consumers still drain what is queued.
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMtx);
+            closed.store(true);
+        }
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+
+    // Claimed minus consumed; may briefly count items that are not yet published.
+    size_t sizeApprox() const {
+        size_t e = enqueuePos.load();
+        size_t d = dequeuePos.load();
+        return e > d ? e - d : 0;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        T value;
+    };
+
+    size_t cellSeq(size_t pos) const { return cells[pos & mask].seq.load(std::memory_order_acquire); }
+
+    // Spins briefly before sleeping, since the other side usually catches up within a few
+    // hundred nanoseconds. Returns false if the queue is closed.
+    template <typename Ready>
+    bool waitFor(std::atomic<int>& waiters, std::condition_variable& cv, Ready ready) {
+        for (int spin = 0; spin < 64; ++spin) {
+            if (ready()) return true;
+            if (closed.load()) return false;
+            std::this_thread::yield();
+        }
+        std::unique_lock<std::mutex> lock(sleepMtx);
+        waiters.fetch_add(1);
+        cv.wait(lock, [&]() { return ready() || closed.load(); });
+        waiters.fetch_sub(1);
+        return !closed.load() || ready();
+    }
+
+    // The fence orders the relaxed position CAS before the waiter check; the sleeper increments
+    // waiters before re-checking the positions, so one side always sees the other.
+    void wake(std::atomic<int>& waiters, std::condition_variable& cv, size_t moved) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load() > 0) {
+            std::lock_guard<std::mutex> lock(sleepMtx);
+            if (moved == 1) {
+                cv.notify_one();
+            } else {
+                cv.notify_all();
+            }
+        }
+    }
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+
+    alignas(64) std::atomic<size_t> enqueuePos{0};
+    alignas(64) std::atomic<size_t> dequeuePos{0};
+
+    alignas(64) std::mutex sleepMtx;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::atomic<int> notEmptyWaiters{0};
+    std::atomic<int> notFullWaiters{0};
+    std::atomic<bool> closed{false};
+};
+
+#endif // MPMC_QUEUE_HPP
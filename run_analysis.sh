@@ -4,8 +4,11 @@ cmake -DCMAKE_EXPORT_COMPILE_COMMANDS=ON ..
 make
 
 echo "Generating call graph:"
-./CallGraphExtractor -p .. ../example.cpp
+./CallGraphExtractor -p .. -j "$(nproc)" -cache-dir=.callgraph-cache -o callgraph.cg ../example.cpp
 
 
 echo -e "\nDetecting thread usage:"
-./ThreadDetector ../example.cpp
+./ThreadDetector -format=json ../example.cpp
+
+echo -e "\nFunctions and globals shared between threads:"
+./ThreadReachability ../example.cpp
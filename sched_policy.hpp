@@ -0,0 +1,372 @@
+// sched_policy.hpp
+#ifndef SCHED_POLICY_HPP
+#define SCHED_POLICY_HPP
+
+#include <string>
+#include <deque>
+#include <queue>
+#include <vector>
+#include <memory>
+#include <limits>
+#include <stdexcept>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+
+// Process-wide string interning for thread names. SimThreads are copied on every push, pop and
+// preemption, so they carry a 4-byte id and only the console and CSV output look the text up.
+class NameTable {
+public:
+    // Id 0 is the empty name and never takes the lock.
+    static uint32_t intern(const std::string& name) {
+        if (name.empty()) return 0;
+        NameTable& t = instance();
+        std::lock_guard<std::mutex> lock(t.mtx);
+        auto [it, inserted] = t.ids.emplace(name, static_cast<uint32_t>(t.names.size()));
+        if (inserted) t.names.push_back(name);
+        return it->second;
+    }
+
+    static const std::string& lookup(uint32_t id) {
+        NameTable& t = instance();
+        std::lock_guard<std::mutex> lock(t.mtx);
+        return t.names[id];  // Elements of a deque never move
+    }
+
+private:
+    static NameTable& instance() {
+        static NameTable table;
+        return table;
+    }
+
+    std::mutex mtx;
+    std::unordered_map<std::string, uint32_t> ids;
+    std::deque<std::string> names{std::string()};
+};
+
+inline std::string threadLabel(int id, uint32_t nameId) {
+    return nameId ? NameTable::lookup(nameId) : "T" + std::to_string(id);
+}
+
+struct SimThread {
+    int id;
+    uint32_t nameId;         // See NameTable
+    int burstTime;
+    int remainingBurstTime;  // This tracks remaining burst time
+    int arrivalTime;         // Simulated arrival (ms); only used by the virtual-clock mode
+    int lastProcessor = -1;  // Processor that ran the previous slice, for migration counting
+    int affinity = -1;       // Processor the thread is pinned to (modulo the count); -1 for any
+
+    int priority = 0;        // Nice value, -20 (highest) .. 19; weights the CFS vruntime
+    int deadline = -1;       // Absolute deadline (ms) for EDF; -1 means none
+    int level = 0;           // Current MLFQ level
+    long long boostEpoch = 0;  // MLFQ boost period in which `level` was last valid
+    long long vruntime = 0;  // Weighted run time for CFS
+
+    // Accounting for sim_metrics.hpp, in ms on the run's clock
+    long long readySince;          // Last time the thread became runnable
+    long long firstRunTime = -1;
+    long long completionTime = -1;
+    long long waitingTime = 0;     // Total time spent runnable but not running
+    int preemptions = 0;
+    int migrations = 0;
+
+    SimThread(int id, const std::string& name, int burstTime, int arrivalTime = 0)
+        : id(id), nameId(NameTable::intern(name)), burstTime(burstTime), remainingBurstTime(burstTime),
+          arrivalTime(arrivalTime), readySince(arrivalTime) {}
+
+    const std::string& name() const { return NameTable::lookup(nameId); }
+
+    // Console name; unnamed threads (see workload.hpp) print as T<id>.
+    std::string label() const { return threadLabel(id, nameId); }
+};
+
+// Orders the runnable threads of one run queue. Every pick-next is O(log n) or better.
+// Policies only reorder at quantum boundaries: a newly arrived thread never interrupts a running slice.
+class SchedPolicy {
+public:
+    virtual ~SchedPolicy() = default;
+
+    virtual const char* name() const = 0;
+
+    // Adds a runnable thread (new arrival or preempted).
+    virtual void push(const SimThread& t) = 0;
+
+    // Removes the thread that should run next; false when empty.
+    virtual bool pop(SimThread& t) = 0;
+
+    // Removes a thread on behalf of another processor's work stealing.
+    virtual bool steal(SimThread& t) { return pop(t); }
+
+    virtual size_t size() const = 0;
+    bool empty() const { return size() == 0; }
+
+    // Length of the next slice for t.
+    virtual int quantumFor(const SimThread&, int baseQuantum) const { return baseQuantum; }
+
+    // Called after t ran for `ran` ms of a `quantum` ms slice, before it is pushed back.
+    // Like quantumFor(), it must not touch policy state: it runs outside the queue lock.
+    virtual void onRan(SimThread&, int /*ran*/, int /*quantum*/) {}
+
+    // The run's clock (ms), given under the queue lock before every pop() or steal().
+    virtual void tick(long long /*nowMs*/) {}
+};
+
+// Double-ended ring of threads; the capacity is a power of two and doubles when full, so a
+// queue that has reached its working size re-queues threads without allocating.
+class ThreadRing {
+public:
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+
+    void push_back(const SimThread& t) {
+        if (count == slots.size()) grow();
+        slots[(head + count) & (slots.size() - 1)] = t;
+        ++count;
+    }
+
+    SimThread& front() { return slots[head]; }
+    SimThread& back() { return slots[(head + count - 1) & (slots.size() - 1)]; }
+
+    void pop_front() {
+        head = (head + 1) & (slots.size() - 1);
+        --count;
+    }
+
+    void pop_back() { --count; }
+
+private:
+    void grow() {
+        std::vector<SimThread> bigger(slots.empty() ? 64 : slots.size() * 2, SimThread(0, "", 0));
+        for (size_t k = 0; k < count; ++k) bigger[k] = slots[(head + k) & (slots.size() - 1)];
+        slots.swap(bigger);
+        head = 0;
+    }
+
+    std::vector<SimThread> slots;
+    size_t head = 0;
+    size_t count = 0;
+};
+
+// FIFO round robin (the original behaviour).
+class RoundRobinPolicy : public SchedPolicy {
+public:
+    const char* name() const override { return "rr"; }
+
+    void push(const SimThread& t) override { threads.push_back(t); }
+
+    bool pop(SimThread& t) override {
+        if (threads.empty()) return false;
+        t = threads.front();
+        threads.pop_front();
+        return true;
+    }
+
+    // The tail is the thread that would otherwise wait longest.
+    bool steal(SimThread& t) override {
+        if (threads.empty()) return false;
+        t = threads.back();
+        threads.pop_back();
+        return true;
+    }
+
+    size_t size() const override { return threads.size(); }
+
+private:
+    ThreadRing threads;
+};
+
+// Binary heap ordered by Key, FIFO among equal keys.
+template <typename Key>
+class HeapPolicy : public SchedPolicy {
+public:
+    void push(const SimThread& t) override { heap.push(Entry{key(t), seq++, t}); }
+
+    bool pop(SimThread& t) override {
+        if (heap.empty()) return false;
+        t = heap.top().thread;
+        heap.pop();
+        return true;
+    }
+
+    size_t size() const override { return heap.size(); }
+
+protected:
+    virtual Key key(const SimThread& t) const = 0;
+
+private:
+    struct Entry {
+        Key key;
+        long long seq;
+        SimThread thread;
+
+        bool operator>(const Entry& other) const {
+            return key != other.key ? key > other.key : seq > other.seq;
+        }
+    };
+
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+    long long seq = 0;
+};
+
+// Shortest remaining time first, re-evaluated at every quantum boundary.
+class SrtfPolicy : public HeapPolicy<int> {
+public:
+    const char* name() const override { return "srtf"; }
+
+protected:
+    int key(const SimThread& t) const override { return t.remainingBurstTime; }
+};
+
+// Earliest deadline first; threads without a deadline run after all that have one.
+class EdfPolicy : public HeapPolicy<int> {
+public:
+    const char* name() const override { return "edf"; }
+
+protected:
+    int key(const SimThread& t) const override {
+        return t.deadline < 0 ? std::numeric_limits<int>::max() : t.deadline;
+    }
+};
+
+// Multi-level feedback queue. Level k uses a quantum of base << k; a thread that uses its
+// whole slice drops one level. Every boostPeriodMs of run time all threads return to level 0
+// so long-running threads cannot starve. The period has to outlast a pass over the backlog:
+// with thousands of queued threads a short one resets every thread before it runs again,
+// and MLFQ degenerates into round robin.
+//
+// The boost is lazy: the demoted levels are spliced, whole, behind the level-0 queue, and a
+// thread's level is only reset when it is next popped or pushed in a later boost epoch. So a
+// boost costs O(levels) and pick-next stays O(1) amortized however many threads are queued.
+class MlfqPolicy : public SchedPolicy {
+public:
+    explicit MlfqPolicy(int numLevels = 3, long long boostPeriodMs = 60000)
+        : levels(numLevels), boostPeriodMs(boostPeriodMs) {
+        front.emplace_back();
+    }
+
+    const char* name() const override { return "mlfq"; }
+
+    void push(const SimThread& t) override {
+        if (t.boostEpoch != epoch || t.level == 0) {
+            front.back().push_back(t);
+            front.back().back().level = 0;
+            front.back().back().boostEpoch = epoch;
+        } else {
+            levels[t.level].push_back(t);
+        }
+        ++count;
+    }
+
+    bool pop(SimThread& t) override {
+        if (count == 0) return false;
+        while (front.size() > 1 && front.front().empty()) front.pop_front();
+        ThreadRing* queue = front.front().empty() ? nullptr : &front.front();
+        for (size_t k = 1; !queue && k < levels.size(); ++k) {
+            if (!levels[k].empty()) queue = &levels[k];
+        }
+        t = queue->front();
+        queue->pop_front();
+        --count;
+        if (t.boostEpoch != epoch) {
+            t.level = 0;
+            t.boostEpoch = epoch;
+        }
+        return true;
+    }
+
+    size_t size() const override { return count; }
+
+    int quantumFor(const SimThread& t, int baseQuantum) const override {
+        return baseQuantum << t.level;
+    }
+
+    void onRan(SimThread& t, int ran, int quantum) override {
+        if (ran >= quantum && t.level + 1 < static_cast<int>(levels.size())) ++t.level;
+    }
+
+    void tick(long long nowMs) override {
+        const long long now = boostPeriodMs > 0 ? nowMs / boostPeriodMs : 0;
+        if (now == epoch) return;
+        epoch = now;
+        // Demoted threads queue behind the level-0 threads, highest level last, and threads
+        // pushed from now on behind them.
+        for (size_t k = 1; k < levels.size(); ++k) {
+            if (!levels[k].empty()) front.push_back(std::move(levels[k]));
+            levels[k] = {};
+        }
+        if (!front.back().empty()) front.emplace_back();
+    }
+
+private:
+    std::deque<ThreadRing> front;    // Level 0, as segments in FIFO order
+    std::vector<ThreadRing> levels;  // levels[0] unused; see front
+    size_t count = 0;
+    long long boostPeriodMs;
+    long long epoch = 0;
+};
+
+// CFS-like: runs the thread with the smallest weighted run time, FIFO among equal ones. A heap
+// rather than the kernel's red-black tree, so that re-queueing a thread allocates no node.
+// Threads joining the queue start at the current minimum so they cannot monopolise it.
+class CfsPolicy : public HeapPolicy<long long> {
+public:
+    const char* name() const override { return "cfs"; }
+
+    void push(const SimThread& t) override {
+        if (t.vruntime < minVruntime) {
+            SimThread adjusted = t;
+            adjusted.vruntime = minVruntime;
+            HeapPolicy::push(adjusted);
+        } else {
+            HeapPolicy::push(t);
+        }
+    }
+
+    bool pop(SimThread& t) override {
+        if (!HeapPolicy::pop(t)) return false;
+        minVruntime = t.vruntime;
+        return true;
+    }
+
+    // vruntime advances by ran * 1024 / weight, where each nice step changes the weight by ~25%.
+    void onRan(SimThread& t, int ran, int) override {
+        t.vruntime += static_cast<long long>(ran) * 1024 / weightFor(t.priority);
+    }
+
+private:
+    static long long weightFor(int nice) {
+        double weight = 1024.0;
+        for (int i = 0; i < nice; ++i) weight /= 1.25;
+        for (int i = 0; i > nice; --i) weight *= 1.25;
+        return weight < 1.0 ? 1 : static_cast<long long>(weight);
+    }
+
+    long long key(const SimThread& t) const override { return t.vruntime; }
+
+    long long minVruntime = 0;
+};
+
+enum class PolicyKind { RoundRobin, SRTF, MLFQ, CFS, EDF };
+
+inline std::unique_ptr<SchedPolicy> makePolicy(PolicyKind kind) {
+    switch (kind) {
+    case PolicyKind::SRTF: return std::make_unique<SrtfPolicy>();
+    case PolicyKind::MLFQ: return std::make_unique<MlfqPolicy>();
+    case PolicyKind::CFS:  return std::make_unique<CfsPolicy>();
+    case PolicyKind::EDF:  return std::make_unique<EdfPolicy>();
+    case PolicyKind::RoundRobin: break;
+    }
+    return std::make_unique<RoundRobinPolicy>();
+}
+
+inline PolicyKind parsePolicy(const std::string& name) {
+    if (name == "rr") return PolicyKind::RoundRobin;
+    if (name == "srtf") return PolicyKind::SRTF;
+    if (name == "mlfq") return PolicyKind::MLFQ;
+    if (name == "cfs") return PolicyKind::CFS;
+    if (name == "edf") return PolicyKind::EDF;
+    throw std::invalid_argument("unknown scheduling policy: " + name);
+}
+
+#endif // SCHED_POLICY_HPP
@@ -0,0 +1,524 @@
+// scheduler_bench.cpp
+#define ALLOC_COUNTER_REPLACE_NEW
+#include "alloc_counter.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <map>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <memory>
+#include <cstdint>
+#include <cmath>
+#include <random>
+
+#include "dag_scheduler.hpp"
+#include "task_queue.hpp"
+#include "thread_scheduler.hpp"
+
+using BenchClock = std::chrono::steady_clock;
+
+static double elapsedNs(BenchClock::time_point start) {
+    return std::chrono::duration<double, std::nano>(BenchClock::now() - start).count();
+}
+
+// Busy work that takes a known time without sleeping, so a benchmark measures the scheduler
+// and not the timer slack of the OS. calibrate() measures the loop once at start-up.
+class SpinKernel {
+public:
+    static void calibrate() {
+        spin(1 << 20);  // Warm up the core's clock
+        uint64_t iterations = 1 << 22;
+        auto start = BenchClock::now();
+        spin(iterations);
+        itersPerNs() = iterations / elapsedNs(start);
+    }
+
+    static uint64_t iterationsFor(double ns) { return static_cast<uint64_t>(ns * itersPerNs()); }
+
+    static double iterationsPerNs() { return itersPerNs(); }
+
+    static void spin(uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; ++i) asm volatile("" ::: "memory");
+    }
+
+private:
+    static double& itersPerNs() {
+        static double value = 1.0;
+        return value;
+    }
+};
+
+struct BenchOptions {
+    unsigned workers = std::max(1u, std::thread::hardware_concurrency());
+    long long maxNodes = 1000000;
+    double workNs = 1000;
+    int repeat = 3;
+    std::string filter;
+};
+
+// One benchmark's numbers. `value` is the headline metric and `lowerIsBetter` says which way a
+// regression goes; `extra` carries details in a fixed key order.
+struct BenchResult {
+    std::string name;
+    std::string unit;
+    double value;
+    bool lowerIsBetter;
+    std::vector<std::pair<std::string, double>> extra;
+};
+
+static double median(std::vector<double> v) {
+    std::sort(v.begin(), v.end());
+    return v[v.size() / 2];
+}
+
+// ---- DAG shapes ----------------------------------------------------------------------------
+// Every generator numbers subtasks 0..n-1 with dependencies on lower ids only and returns the
+// depth (subtasks on the longest path), which bounds the speedup.
+
+using Shape = std::vector<std::vector<int>>;  // dependencies[i]
+
+static int chainShape(long long n, Shape& deps) {
+    deps.assign(n, {});
+    for (long long i = 1; i < n; ++i) deps[i] = {static_cast<int>(i - 1)};
+    return static_cast<int>(n);
+}
+
+// One root fans out to n - 2 independent subtasks that all join into one sink.
+static int wideShape(long long n, Shape& deps) {
+    deps.assign(n, {});
+    for (long long i = 1; i + 1 < n; ++i) deps[i] = {0};
+    for (long long i = 1; i + 1 < n; ++i) deps[n - 1].push_back(static_cast<int>(i));
+    return 3;
+}
+
+// Stacked diamonds: a join subtask, 8 parallel branches off it, the next join, and so on.
+static int diamondShape(long long n, Shape& deps) {
+    const int width = 8;
+    deps.assign(n, {});
+    int depth = 1;
+    int join = 0;
+    for (long long i = 1; i < n;) {
+        long long branches = std::min<long long>(width, n - i);
+        for (long long b = 0; b < branches; ++b) deps[i + b] = {join};
+        i += branches;
+        ++depth;
+        if (i == n) break;
+        for (long long b = 0; b < branches; ++b) deps[i].push_back(static_cast<int>(i - branches + b));
+        join = static_cast<int>(i++);
+        ++depth;
+    }
+    return depth;
+}
+
+// Up to 3 dependencies per subtask among the 64 before it, from a fixed seed.
+static int randomShape(long long n, Shape& deps) {
+    std::mt19937_64 gen(42);
+    deps.assign(n, {});
+    std::vector<int> level(n, 1);
+    int depth = n > 0 ? 1 : 0;
+    for (long long i = 1; i < n; ++i) {
+        const long long window = std::min<long long>(i, 64);
+        const int count = static_cast<int>(gen() % 4);
+        for (int k = 0; k < count; ++k) {
+            int dep = static_cast<int>(i - 1 - static_cast<long long>(gen() % window));
+            if (std::find(deps[i].begin(), deps[i].end(), dep) == deps[i].end()) {
+                deps[i].push_back(dep);
+                level[i] = std::max(level[i], level[dep] + 1);
+            }
+        }
+        depth = std::max(depth, level[i]);
+    }
+    return depth;
+}
+
+// Runs one DAG repeatedly on a persistent pool. ns_per_node is the wall time per subtask;
+// efficiency compares it with the best schedule the shape allows at this work size
+// (max of the longest path and total work / workers), so 1.0 means zero overhead.
+static BenchResult benchDag(const std::string& shapeName, int (*shape)(long long, Shape&), long long n,
+                            WorkStealingPool& pool, const BenchOptions& opt) {
+    Shape deps;
+    const int depth = shape(n, deps);
+    const uint64_t iterations = SpinKernel::iterationsFor(opt.workNs);
+
+    auto compileStart = BenchClock::now();
+    std::vector<SubTask> subtasks;
+    subtasks.reserve(n);
+    for (long long i = 0; i < n; ++i) {
+        subtasks.push_back(SubTask{static_cast<int>(i), [iterations]() { SpinKernel::spin(iterations); },
+                                   std::move(deps[i]), 1.0, nullptr});
+    }
+    auto graph = std::make_shared<CompiledDAG>(std::move(subtasks));
+    const double compileNs = elapsedNs(compileStart);
+
+    DAGScheduler dag(graph);
+    dag.setVerbose(false);
+    dag.execute(pool);  // Warm-up: grows the worker deques to their steady-state size
+
+    std::vector<double> runs;
+    runs.reserve(opt.repeat);  // Not counted as an allocation of the run
+    uint64_t allocations = 0;
+    for (int r = 0; r < opt.repeat; ++r) {
+        AllocCounter::Scope scope;
+        auto start = BenchClock::now();
+        dag.execute(pool);
+        runs.push_back(elapsedNs(start));
+        allocations += scope.allocations();
+    }
+
+    const double wallNs = median(runs);
+    const double idealNs = opt.workNs * std::max<double>(depth, static_cast<double>(n) / pool.size());
+    return BenchResult{"dag." + shapeName + ".n" + std::to_string(n),
+                       "ns/node",
+                       wallNs / n,
+                       true,
+                       {{"nodes", static_cast<double>(n)},
+                        {"depth", static_cast<double>(depth)},
+                        {"wall_ms", wallNs / 1e6},
+                        {"nodes_per_sec", n / (wallNs / 1e9)},
+                        {"efficiency", idealNs > 0 ? idealNs / wallNs : 0.0},
+                        {"compile_ns_per_node", compileNs / n},
+                        {"allocs_per_run", static_cast<double>(allocations) / opt.repeat}}};
+}
+
+// `producers` threads push `items` Tasks in total through one TaskQueue while `consumers`
+// threads pop them; ops/sec counts each item once.
+static BenchResult benchTaskQueue(int producers, int consumers, long long items, const BenchOptions& opt) {
+    std::vector<double> runs;
+    uint64_t allocations = 0;
+    for (int r = 0; r < opt.repeat; ++r) {
+        TaskQueue queue;
+        std::atomic<long long> popped{0};
+        std::atomic<bool> go{false};
+
+        std::vector<std::thread> threads;
+        for (int c = 0; c < consumers; ++c) {
+            threads.emplace_back([&]() {
+                while (!go.load(std::memory_order_acquire)) {}
+                Task task;
+                long long mine = 0;
+                while (queue.pop(task)) ++mine;
+                popped.fetch_add(mine);
+            });
+        }
+        std::vector<std::thread> producerThreads;
+        for (int p = 0; p < producers; ++p) {
+            const long long share = items / producers + (p < items % producers ? 1 : 0);
+            producerThreads.emplace_back([&, share]() {
+                while (!go.load(std::memory_order_acquire)) {}
+                for (long long i = 0; i < share; ++i) queue.push(Task{static_cast<int>(i), nullptr});
+            });
+        }
+
+        AllocCounter::Scope scope;  // The threads are already running
+        auto start = BenchClock::now();
+        go.store(true, std::memory_order_release);
+        for (auto& t : producerThreads) t.join();
+        queue.shutdown();
+        for (auto& t : threads) t.join();
+        runs.push_back(elapsedNs(start));
+        allocations += scope.allocations();
+        if (popped.load() != items) std::cerr << "TaskQueue lost items: " << popped.load() << " of " << items << "\n";
+    }
+
+    const double wallNs = median(runs);
+    return BenchResult{"taskqueue.p" + std::to_string(producers) + ".c" + std::to_string(consumers),
+                       "ops/s",
+                       items / (wallNs / 1e9),
+                       false,
+                       {{"items", static_cast<double>(items)},
+                        {"ns_per_op", wallNs / items},
+                        {"allocs_per_op", static_cast<double>(allocations) / opt.repeat / items}}};
+}
+
+// Cost of one pick-next/account/re-queue cycle of the virtual-clock engine, which does no
+// sleeping, so the wall time is pure scheduler overhead. The engine's console summary is
+// discarded.
+static BenchResult benchDispatch(PolicyKind policy, const char* policyName, int threads, const BenchOptions& opt) {
+    std::vector<double> runs;
+    long long dispatches = 0;
+    uint64_t allocations = 0;
+    for (int r = 0; r < opt.repeat; ++r) {
+        ThreadScheduler scheduler(10, policy);
+        scheduler.setVerbose(false);
+        scheduler.setSummaries(false);
+        SyntheticWorkload workload;
+        workload.seed = 7;
+        workload.count = threads;
+        workload.arrivalRate = 1000;
+        workload.minBurst = 5;
+        workload.maxBurst = 100;
+        SyntheticArrivalSource source(workload);
+
+        AllocCounter::Scope scope;
+        auto start = BenchClock::now();
+        scheduler.runSimulated(4, source);
+        runs.push_back(elapsedNs(start));
+        allocations += scope.allocations();
+
+        dispatches = scheduler.metrics().totalDispatches();
+    }
+
+    const double wallNs = median(runs);
+    return BenchResult{std::string("dispatch.") + policyName + ".t" + std::to_string(threads),
+                       "ns/dispatch",
+                       wallNs / dispatches,
+                       true,
+                       {{"threads", static_cast<double>(threads)},
+                        {"dispatches", static_cast<double>(dispatches)},
+                        {"allocs_per_dispatch", static_cast<double>(allocations) / opt.repeat / dispatches}}};
+}
+
+// Tasks down the path MultiProcessorEnv takes: a pool worker with nothing else to do pops one
+// from the TaskQueue in its idle poll and starts its DAG (the same five-subtask pipeline, spinning
+// instead of sleeping) from a recycled RunningTask. A warm-up batch fills the free list and the
+// worker deques first, so allocs_per_task is what a Task costs from submission to completion.
+static BenchResult benchTaskDispatch(long long tasks, const BenchOptions& opt) {
+    const uint64_t iterations = SpinKernel::iterationsFor(opt.workNs);
+    const std::vector<std::vector<int>> deps{{}, {1}, {1}, {2, 3}, {4}};
+    std::vector<SubTask> subtasks;
+    for (int i = 0; i < 5; ++i)
+        subtasks.push_back(SubTask{i + 1, [iterations]() { SpinKernel::spin(iterations); }, deps[i], 1.0, nullptr});
+    auto pipeline = std::make_shared<CompiledDAG>(std::move(subtasks));
+
+    TaskQueue queue;
+    RunningTaskPool runners;
+    std::atomic<long long> finished{0};
+    WorkStealingPool pool(opt.workers, [&](WorkStealingPool& workers, unsigned worker) {
+        Task task;
+        if (!queue.try_pop(task)) return false;
+        RunningTask* running = runners.acquire(std::move(task), static_cast<int>(worker));
+        running->dag.setVerbose(false);
+        running->dag.executeAsync(workers, [&runners, &finished, running]() {
+            runners.release(running);
+            finished.fetch_add(1, std::memory_order_release);
+        });
+        return true;
+    });
+
+    long long submitted = 0;
+    auto runBatch = [&](long long count) {
+        for (long long i = 0; i < count; ++i) {
+            queue.push(Task{static_cast<int>(i), pipeline});
+            pool.notify();
+        }
+        submitted += count;
+        while (finished.load(std::memory_order_acquire) < submitted) std::this_thread::yield();
+    };
+    runBatch(std::min(tasks, 1000LL));
+
+    std::vector<double> runs;
+    runs.reserve(opt.repeat);
+    uint64_t allocations = 0;
+    for (int r = 0; r < opt.repeat; ++r) {
+        AllocCounter::Scope scope;
+        auto start = BenchClock::now();
+        runBatch(tasks);
+        runs.push_back(elapsedNs(start));
+        allocations += scope.allocations();
+    }
+
+    const double wallNs = median(runs);
+    return BenchResult{"tasks.pipeline.n" + std::to_string(tasks),
+                       "ns/task",
+                       wallNs / tasks,
+                       true,
+                       {{"tasks", static_cast<double>(tasks)},
+                        {"allocs_per_task", static_cast<double>(allocations) / opt.repeat / tasks}}};
+}
+
+// MLFQ has to schedule a large mixed backlog differently from round robin: if its boost resets
+// every demoted thread before it runs again, both produce identical runs. Returns false then.
+static bool checkMlfqDiffersFromRoundRobin() {
+    long long dispatches[2], preemptions[2];
+    const PolicyKind kinds[2] = {PolicyKind::RoundRobin, PolicyKind::MLFQ};
+    for (int k = 0; k < 2; ++k) {
+        ThreadScheduler scheduler(100, kinds[k]);
+        scheduler.setVerbose(false);
+        scheduler.setSummaries(false);
+        SyntheticWorkload workload;
+        workload.seed = 1;
+        workload.count = 2000;
+        SyntheticArrivalSource source(workload);
+        scheduler.runSimulated(4, source);
+        dispatches[k] = scheduler.metrics().totalDispatches();
+        preemptions[k] = static_cast<long long>(scheduler.metrics().preemptionCounts().mean() * 1000);
+    }
+    std::cerr << "check.mlfq_vs_rr: " << dispatches[0] << " vs " << dispatches[1] << " dispatches\n";
+    return dispatches[0] != dispatches[1] && preemptions[0] != preemptions[1];
+}
+
+// One result per line, in a fixed order, so two runs can be compared with plain diff or with
+// --baseline.
+static void writeJson(std::ostream& out, const BenchOptions& opt, const std::vector<BenchResult>& results) {
+    out << std::setprecision(6);
+    out << "{\n  \"machine\": {\"hardware_concurrency\": " << std::thread::hardware_concurrency()
+        << ", \"workers\": " << opt.workers << ", \"spin_iters_per_ns\": " << SpinKernel::iterationsPerNs()
+        << "},\n  \"config\": {\"work_ns\": " << opt.workNs << ", \"repeat\": " << opt.repeat
+        << ", \"max_nodes\": " << opt.maxNodes << "},\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        out << (i ? "," : "") << "\n    {\"name\": \"" << r.name << "\", \"value\": " << r.value << ", \"unit\": \""
+            << r.unit << "\", \"lower_is_better\": " << (r.lowerIsBetter ? "true" : "false");
+        for (const auto& [key, v] : r.extra) out << ", \"" << key << "\": " << v;
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+// Reads name/value pairs back from a file written by writeJson().
+static std::map<std::string, double> readBaseline(const std::string& path) {
+    std::map<std::string, double> values;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t name = line.find("{\"name\": \"");
+        size_t value = line.find("\"value\": ");
+        if (name == std::string::npos || value == std::string::npos) continue;
+        name += 10;
+        values[line.substr(name, line.find('"', name) - name)] = std::stod(line.substr(value + 9));
+    }
+    return values;
+}
+
+// Prints the change of every benchmark present in both runs; returns how many got worse by
+// more than `threshold` (a fraction).
+static int compareWithBaseline(const std::map<std::string, double>& baseline, const std::vector<BenchResult>& results,
+                               double threshold) {
+    int regressions = 0;
+    for (const BenchResult& r : results) {
+        auto it = baseline.find(r.name);
+        if (it == baseline.end() || it->second == 0) continue;
+        const double change = (r.value - it->second) / it->second;
+        const bool worse = r.lowerIsBetter ? change > threshold : change < -threshold;
+        regressions += worse;
+        std::cerr << std::left << std::setw(32) << r.name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(8) << 100.0 * change << "%" << (worse ? "  REGRESSION" : "") << "\n";
+    }
+    std::cerr.unsetf(std::ios::floatfield);
+    return regressions;
+}
+
+// Usage: scheduler_bench [--json=PATH] [--workers=N] [--max-nodes=N] [--work-ns=NS] [--repeat=N]
+//                        [--filter=TEXT] [--quick] [--baseline=PATH] [--threshold=F]
+//   --json=PATH      write the results there instead of stdout
+//   --workers=N      pool size for the DAG benchmarks (default: one per core)
+//   --max-nodes=N    largest DAG, in powers of ten from 10 (default 1000000)
+//   --work-ns=NS     spin time of every DAG subtask (default 1000)
+//   --repeat=N       runs per benchmark; the median is reported (default 3)
+//   --filter=TEXT    only benchmarks whose name contains TEXT
+//   --quick          --max-nodes=10000 --repeat=1
+//   --baseline=PATH  compare with an earlier --json file; exit status 2 if any benchmark
+//                    regressed by more than --threshold (default 0.10)
+// Exit status 3 if a sanity check (check.*) failed.
+int main(int argc, char** argv) {
+    BenchOptions opt;
+    std::string jsonPath, baselinePath;
+    double threshold = 0.10;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--json=", 0) == 0) {
+            jsonPath = arg.substr(7);
+        } else if (arg.rfind("--workers=", 0) == 0) {
+            opt.workers = std::max(1, std::stoi(arg.substr(10)));
+        } else if (arg.rfind("--max-nodes=", 0) == 0) {
+            opt.maxNodes = std::stoll(arg.substr(12));
+        } else if (arg.rfind("--work-ns=", 0) == 0) {
+            opt.workNs = std::stod(arg.substr(10));
+        } else if (arg.rfind("--repeat=", 0) == 0) {
+            opt.repeat = std::max(1, std::stoi(arg.substr(9)));
+        } else if (arg.rfind("--filter=", 0) == 0) {
+            opt.filter = arg.substr(9);
+        } else if (arg == "--quick") {
+            opt.maxNodes = 10000;
+            opt.repeat = 1;
+        } else if (arg.rfind("--baseline=", 0) == 0) {
+            baselinePath = arg.substr(11);
+        } else if (arg.rfind("--threshold=", 0) == 0) {
+            threshold = std::stod(arg.substr(12));
+        } else {
+            std::cerr << "Unknown option: " << arg << "\n";
+            return 1;
+        }
+    }
+
+    SpinKernel::calibrate();
+    auto selected = [&](const std::string& name) { return name.find(opt.filter) != std::string::npos; };
+    auto progress = [](const BenchResult& r) {
+        std::cerr << std::left << std::setw(32) << r.name << std::right << std::setw(14) << r.value << " " << r.unit
+                  << "\n";
+    };
+
+    std::vector<BenchResult> results;
+    {
+        WorkStealingPool pool(opt.workers);
+        const std::pair<const char*, int (*)(long long, Shape&)> shapes[] = {
+            {"chain", chainShape}, {"wide", wideShape}, {"diamond", diamondShape}, {"random", randomShape}};
+        for (const auto& [name, shape] : shapes) {
+            for (long long n = 10; n <= opt.maxNodes; n *= 10) {
+                if (!selected(std::string("dag.") + name + ".n" + std::to_string(n))) continue;
+                results.push_back(benchDag(name, shape, n, pool, opt));
+                progress(results.back());
+            }
+        }
+    }
+
+    const int maxThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    for (int p = 1; p <= maxThreads; p *= 2) {
+        for (int c = 1; c <= maxThreads; c *= 2) {
+            if (!selected("taskqueue.p" + std::to_string(p) + ".c" + std::to_string(c))) continue;
+            results.push_back(benchTaskQueue(p, c, 1 << 20, opt));
+            progress(results.back());
+        }
+    }
+
+    if (selected("tasks.pipeline.n100000")) {
+        results.push_back(benchTaskDispatch(100000, opt));
+        progress(results.back());
+    }
+
+    const std::pair<PolicyKind, const char*> policies[] = {{PolicyKind::RoundRobin, "rr"},
+                                                           {PolicyKind::SRTF, "srtf"},
+                                                           {PolicyKind::MLFQ, "mlfq"},
+                                                           {PolicyKind::CFS, "cfs"},
+                                                           {PolicyKind::EDF, "edf"}};
+    for (const auto& [policy, name] : policies) {
+        if (!selected(std::string("dispatch.") + name + ".t100000")) continue;
+        results.push_back(benchDispatch(policy, name, 100000, opt));
+        progress(results.back());
+    }
+
+    bool checksPassed = true;
+    if (selected("check.mlfq_vs_rr") && !checkMlfqDiffersFromRoundRobin()) {
+        std::cerr << "check.mlfq_vs_rr FAILED: MLFQ scheduled exactly like round robin\n";
+        checksPassed = false;
+    }
+
+    if (jsonPath.empty()) {
+        writeJson(std::cout, opt, results);
+    } else {
+        std::ofstream out(jsonPath);
+        writeJson(out, opt, results);
+        if (!out) {
+            std::cerr << "Failed to write " << jsonPath << "\n";
+            return 1;
+        }
+    }
+
+    if (!baselinePath.empty()) {
+        auto baseline = readBaseline(baselinePath);
+        if (baseline.empty()) {
+            std::cerr << "No results in " << baselinePath << "\n";
+            return 1;
+        }
+        if (compareWithBaseline(baseline, results, threshold) > 0) return 2;
+    }
+    return checksPassed ? 0 : 3;
+}
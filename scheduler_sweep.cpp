@@ -0,0 +1,287 @@
+// scheduler_sweep.cpp
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <algorithm>
+#include <cstdint>
+
+#include "thread_scheduler.hpp"
+
+// One point of the sweep.
+struct SweepConfig {
+    PolicyKind policy;
+    std::string policyName;
+    int quantum;
+    int processors;
+    long long threads;
+    std::string bursts;
+    uint64_t seed;
+};
+
+struct SweepResult {
+    long long makespanMs = 0;
+    size_t completed = 0;
+    double turnaroundMean = 0, waitingMean = 0, responseMean = 0;
+    long long turnaroundP99 = 0, responseP99 = 0;
+    double utilization = 0;
+    long long dispatches = 0;
+    long long migrations = 0;
+    double lostMs = 0;
+    int finalQuantum = 0;
+    double wallMs = 0;
+};
+
+// "a,b,c" or an inclusive range "lo:hi" / "lo:hi:step".
+static std::vector<long long> parseNumberList(const std::string& spec) {
+    std::vector<long long> values;
+    std::istringstream in(spec);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        const size_t colon = item.find(':');
+        if (colon == std::string::npos) {
+            values.push_back(std::stoll(item));
+            continue;
+        }
+        const size_t second = item.find(':', colon + 1);
+        const long long lo = std::stoll(item.substr(0, colon));
+        const long long hi = std::stoll(item.substr(colon + 1, second - colon - 1));
+        const long long step = second == std::string::npos ? 1 : std::stoll(item.substr(second + 1));
+        if (step <= 0) throw std::invalid_argument("range step must be positive: " + item);
+        for (long long v = lo; v <= hi; v += step) values.push_back(v);
+    }
+    if (values.empty()) throw std::invalid_argument("empty list: " + spec);
+    return values;
+}
+
+static std::vector<std::string> parseNameList(const std::string& spec) {
+    std::vector<std::string> names;
+    std::istringstream in(spec);
+    std::string item;
+    while (std::getline(in, item, ','))
+        if (!item.empty()) names.push_back(item);
+    if (names.empty()) throw std::invalid_argument("empty list: " + spec);
+    return names;
+}
+
+// Each configuration gets its own scheduler and workload, so runs share nothing but the
+// process-wide NameTable (workload threads are unnamed and never take its lock).
+static SweepResult runConfig(const SweepConfig& c, const SyntheticWorkload& base, const CostModel& costModel) {
+    ThreadScheduler scheduler(c.quantum, c.policy);
+    scheduler.setVerbose(false);
+    scheduler.setSummaries(false);
+    scheduler.setCostModel(costModel);
+
+    SyntheticWorkload workload = base;
+    workload.seed = c.seed;
+    workload.count = c.threads;
+    workload.bursts = parseBursts(c.bursts);
+    SyntheticArrivalSource source(workload);
+
+    auto start = std::chrono::steady_clock::now();
+    scheduler.runSimulated(c.processors, source);
+
+    const SimMetrics& m = scheduler.metrics();
+    SweepResult r;
+    r.wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    r.makespanMs = m.makespanMs();
+    r.completed = m.completedThreads();
+    r.turnaroundMean = m.turnaroundMs().mean();
+    r.turnaroundP99 = m.turnaroundMs().percentile(0.99);
+    r.waitingMean = m.waitingMs().mean();
+    r.responseMean = m.responseMs().mean();
+    r.responseP99 = m.responseMs().percentile(0.99);
+    r.utilization = m.meanUtilization();
+    r.dispatches = m.totalDispatches();
+    r.migrations = scheduler.migrationCount();
+    r.lostMs = m.lostUs() / 1000.0;
+    r.finalQuantum = scheduler.lastQuantum();
+    return r;
+}
+
+static void writeCsvHeader(std::ostream& out) {
+    out << "policy,quantum_ms,processors,threads,bursts,seed,makespan_ms,completed,turnaround_mean_ms,"
+           "turnaround_p99_ms,waiting_mean_ms,response_mean_ms,response_p99_ms,utilization,dispatches,"
+           "migrations,lost_ms,final_quantum_ms,wall_ms\n";
+}
+
+static void writeCsvRow(std::ostream& out, const SweepConfig& c, const SweepResult& r) {
+    out << c.policyName << "," << c.quantum << "," << c.processors << "," << c.threads << "," << c.bursts << ","
+        << c.seed << "," << r.makespanMs << "," << r.completed << "," << r.turnaroundMean << "," << r.turnaroundP99
+        << "," << r.waitingMean << "," << r.responseMean << "," << r.responseP99 << "," << r.utilization << ","
+        << r.dispatches << "," << r.migrations << "," << r.lostMs << "," << r.finalQuantum << "," << r.wallMs
+        << "\n";
+}
+
+// Usage: scheduler_sweep [--policy=LIST] [--quantum=LIST] [--processors=LIST] [--threads=LIST]
+//                        [--bursts=LIST] [--seed=LIST] [--jobs=N] [--out=PATH]
+//                        [--arrival-rate=R] [--max-burst=MS] [--pareto-shape=A] [--switch-cost-us=N]
+//                        [--migration-cost-us=N] [--cache-half-life-ms=N] [--adaptive-quantum]
+//
+// Runs every combination of the listed parameters on the virtual clock, one independent
+// scheduler per configuration, --jobs (default: all host cores) at a time, and writes one CSV
+// row per configuration to --out (default stdout) in the order the combinations are listed.
+// Numeric lists are "a,b,c" or inclusive ranges "lo:hi[:step]", e.g. --seed=1:20.
+//   --policy      rr,srtf,mlfq,cfs,edf (default rr)
+//   --quantum     base time quantum in ms (default 500)
+//   --processors  default 4
+//   --threads     generated threads per run (default 10)
+//   --bursts      uniform,pareto (default uniform)
+//   --seed        workload seeds (default 1)
+// The remaining options apply to every configuration, as in thread_sim.
+int main(int argc, char** argv) {
+    std::vector<std::string> policies{"rr"}, bursts{"uniform"};
+    std::vector<long long> quanta{500}, processors{4}, threads{10}, seeds{1};
+    unsigned jobs = std::max(1u, std::thread::hardware_concurrency());
+    std::string outPath;
+    SyntheticWorkload base;
+    CostModel costModel;
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg.rfind("--policy=", 0) == 0) {
+                policies = parseNameList(arg.substr(9));
+            } else if (arg.rfind("--quantum=", 0) == 0) {
+                quanta = parseNumberList(arg.substr(10));
+            } else if (arg.rfind("--processors=", 0) == 0) {
+                processors = parseNumberList(arg.substr(13));
+            } else if (arg.rfind("--threads=", 0) == 0) {
+                threads = parseNumberList(arg.substr(10));
+            } else if (arg.rfind("--bursts=", 0) == 0) {
+                bursts = parseNameList(arg.substr(9));
+            } else if (arg.rfind("--seed=", 0) == 0) {
+                seeds = parseNumberList(arg.substr(7));
+            } else if (arg.rfind("--jobs=", 0) == 0) {
+                jobs = std::max(1, std::stoi(arg.substr(7)));
+            } else if (arg.rfind("--out=", 0) == 0) {
+                outPath = arg.substr(6);
+            } else if (arg.rfind("--arrival-rate=", 0) == 0) {
+                base.arrivalRate = std::stod(arg.substr(15));
+            } else if (arg.rfind("--max-burst=", 0) == 0) {
+                base.maxBurst = base.paretoCap = std::stoi(arg.substr(12));
+            } else if (arg.rfind("--pareto-shape=", 0) == 0) {
+                base.paretoShape = std::stod(arg.substr(15));
+            } else if (arg.rfind("--switch-cost-us=", 0) == 0) {
+                costModel.switchUs = std::stoll(arg.substr(17));
+            } else if (arg.rfind("--migration-cost-us=", 0) == 0) {
+                costModel.migrationUs = std::stoll(arg.substr(20));
+            } else if (arg.rfind("--cache-half-life-ms=", 0) == 0) {
+                costModel.cacheHalfLifeMs = std::stoll(arg.substr(21));
+            } else if (arg == "--adaptive-quantum") {
+                costModel.adaptiveQuantum = true;
+            } else {
+                std::cerr << "Unknown option: " << arg << "\n";
+                return 1;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Bad option value: " << e.what() << "\n";
+        return 1;
+    }
+
+    std::vector<SweepConfig> configs;
+    try {
+        for (const std::string& policy : policies) {
+            const PolicyKind kind = parsePolicy(policy);
+            for (const std::string& b : bursts) {
+                parseBursts(b);  // Reject unknown names before anything runs
+                for (long long q : quanta)
+                    for (long long p : processors)
+                        for (long long n : threads)
+                            for (long long seed : seeds) {
+                                if (q <= 0 || p <= 0 || n < 0)
+                                    throw std::invalid_argument("quantum, processors and threads must be positive");
+                                configs.push_back(SweepConfig{kind, policy, static_cast<int>(q), static_cast<int>(p),
+                                                              n, b, static_cast<uint64_t>(seed)});
+                            }
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    std::ofstream file;
+    if (!outPath.empty()) {
+        file.open(outPath);
+        if (!file) {
+            std::cerr << "Failed to open " << outPath << "\n";
+            return 1;
+        }
+    }
+    std::ostream& out = outPath.empty() ? std::cout : file;
+
+    // Workers claim configurations in order; finished rows are written as soon as every earlier
+    // one is, so the output order does not depend on timing.
+    std::vector<SweepResult> results(configs.size());
+    std::vector<char> finished(configs.size(), 0);
+    size_t written = 0;
+    std::atomic<size_t> next{0};
+    std::mutex outputMutex;
+    std::exception_ptr error;
+
+    writeCsvHeader(out);
+    out << std::fixed << std::setprecision(3);
+    auto worker = [&]() {
+        while (true) {
+            const size_t i = next.fetch_add(1);
+            if (i >= configs.size()) return;
+            SweepResult r;
+            try {
+                r = runConfig(configs[i], base, costModel);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(outputMutex);
+                if (!error) error = std::current_exception();
+                next.store(configs.size());  // Stop handing out work
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(outputMutex);
+            results[i] = r;
+            finished[i] = 1;
+            const size_t before = written;
+            while (written < configs.size() && finished[written]) {
+                writeCsvRow(out, configs[written], results[written]);
+                ++written;
+            }
+            if (written != before) {
+                out.flush();
+                std::cerr << "\r" << written << "/" << configs.size() << " configurations" << std::flush;
+            }
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (unsigned j = 0; j < std::min<size_t>(jobs, configs.size()); ++j)
+        workers.emplace_back(worker);
+    for (auto& w : workers)
+        w.join();
+    std::cerr << "\n";
+
+    if (error) {
+        try {
+            std::rethrow_exception(error);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+        }
+        return 1;
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << configs.size() << " configurations on " << workers.size() << " workers in " << std::fixed
+              << std::setprecision(2) << seconds << "s\n";
+    if (!out) {
+        std::cerr << "Failed to write " << (outPath.empty() ? "stdout" : outPath) << "\n";
+        return 1;
+    }
+    return 0;
+}
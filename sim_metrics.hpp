@@ -0,0 +1,243 @@
+// sim_metrics.hpp
+#ifndef SIM_METRICS_HPP
+#define SIM_METRICS_HPP
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "sched_policy.hpp"
+
+// Final accounting for one completed SimThread. All times are ms on the run's clock.
+struct ThreadRecord {
+    int id;
+    uint32_t nameId;
+    long long arrival;
+    long long firstRun;
+    long long completion;
+    int burst;
+    long long waiting;
+    int preemptions;
+    int migrations;
+
+    long long turnaround() const { return completion - arrival; }
+    long long response() const { return firstRun - arrival; }
+
+    static ThreadRecord from(const SimThread& t) {
+        return ThreadRecord{t.id, t.nameId, t.arrivalTime, t.firstRunTime, t.completionTime,
+                            t.burstTime, t.waitingTime, t.preemptions, t.migrations};
+    }
+};
+
+// Written only by the processor that owns it, merged after the run.
+struct ProcessorMetrics {
+    long long busyMs = 0;
+    long long dispatches = 0;
+    long long switchUs = 0;  // Busy time lost to context switches (CostModel)
+    long long refillUs = 0;  // Busy time lost to refilling caches after migrations
+    std::vector<ThreadRecord> completed;
+};
+
+// Power-of-two buckets plus exact percentiles over the recorded samples.
+class LatencyHistogram {
+public:
+    void add(long long v) { samples.push_back(v); }
+
+    void finalize() { std::sort(samples.begin(), samples.end()); }
+
+    // Nearest-rank percentile, q in (0, 1]; call finalize() first.
+    long long percentile(double q) const {
+        if (samples.empty()) return 0;
+        size_t rank = static_cast<size_t>(q * samples.size() + 0.999999);
+        rank = std::min(std::max<size_t>(rank, 1), samples.size());
+        return samples[rank - 1];
+    }
+
+    double mean() const {
+        if (samples.empty()) return 0.0;
+        long double sum = 0;
+        for (long long v : samples) sum += v;
+        return static_cast<double>(sum / samples.size());
+    }
+
+    // buckets[k] counts samples in [2^(k-1), 2^k), with bucket 0 holding zeros.
+    std::vector<long long> buckets() const {
+        std::vector<long long> counts;
+        for (long long v : samples) {
+            size_t k = 0;
+            while (v > 0) { v >>= 1; ++k; }
+            if (counts.size() <= k) counts.resize(k + 1, 0);
+            ++counts[k];
+        }
+        return counts;
+    }
+
+private:
+    std::vector<long long> samples;
+};
+
+class SimMetrics {
+public:
+    void reset(int numProcessors) {
+        processors.assign(numProcessors, ProcessorMetrics{});
+        threads.clear();
+        makespan = 0;
+    }
+
+    ProcessorMetrics& processor(int i) { return processors[i]; }
+
+    long long makespanMs() const { return makespan; }
+    size_t completedThreads() const { return threads.size(); }
+
+    // Valid after finish().
+    const LatencyHistogram& turnaroundMs() const { return turnaround; }
+    const LatencyHistogram& waitingMs() const { return waiting; }
+    const LatencyHistogram& responseMs() const { return response; }
+    const LatencyHistogram& preemptionCounts() const { return preemptions; }
+
+    double meanUtilization() const {
+        if (processors.empty()) return 0.0;
+        double total = 0.0;
+        for (size_t i = 0; i < processors.size(); ++i) total += utilization(i);
+        return total / processors.size();
+    }
+
+    // Busy time that did no thread's work, over all processors.
+    long long lostUs() const {
+        long long total = 0;
+        for (const auto& p : processors) total += p.switchUs + p.refillUs;
+        return total;
+    }
+
+    long long totalDispatches() const {
+        long long total = 0;
+        for (const auto& p : processors) total += p.dispatches;
+        return total;
+    }
+
+    // Merges the per-processor buffers; call once every processor has stopped.
+    void finish(long long makespanMs) {
+        makespan = makespanMs;
+        threads.clear();
+        for (auto& p : processors) {
+            threads.insert(threads.end(), p.completed.begin(), p.completed.end());
+        }
+        std::sort(threads.begin(), threads.end(),
+                  [](const ThreadRecord& a, const ThreadRecord& b) { return a.id < b.id; });
+
+        turnaround = waiting = response = preemptions = LatencyHistogram{};
+        for (const auto& r : threads) {
+            turnaround.add(r.turnaround());
+            waiting.add(r.waiting);
+            response.add(r.response());
+            preemptions.add(r.preemptions);
+        }
+        for (auto* h : {&turnaround, &waiting, &response, &preemptions}) h->finalize();
+    }
+
+    void printSummary() const {
+        std::cout << "\n=== Scheduling Metrics (" << threads.size() << " threads, makespan "
+                  << makespan << "ms) ===\n";
+        std::cout << std::left << std::setw(16) << "" << std::right << std::setw(10) << "mean"
+                  << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(10) << "p999" << "\n";
+        printRow("turnaround(ms)", turnaround);
+        printRow("waiting(ms)", waiting);
+        printRow("response(ms)", response);
+        printRow("preemptions", preemptions);
+        for (size_t i = 0; i < processors.size(); ++i) {
+            std::cout << "P" << i << ": utilization " << std::fixed << std::setprecision(1)
+                      << 100.0 * utilization(i) << "%, idle " << idleMs(i) << "ms, "
+                      << processors[i].dispatches << " dispatches";
+            if (processors[i].switchUs + processors[i].refillUs > 0)
+                std::cout << ", lost " << (processors[i].switchUs + processors[i].refillUs) / 1000.0 << "ms";
+            std::cout << "\n";
+        }
+        if (lostUs() > 0) {
+            long long switchUs = 0, refillUs = 0;
+            for (const auto& p : processors) {
+                switchUs += p.switchUs;
+                refillUs += p.refillUs;
+            }
+            const double capacityUs = 1000.0 * makespan * processors.size();
+            std::cout << "Lost capacity: " << switchUs / 1000.0 << "ms switching, " << refillUs / 1000.0
+                      << "ms cache refill (" << (capacityUs > 0 ? 100.0 * lostUs() / capacityUs : 0.0)
+                      << "% of processor time)\n";
+        }
+        std::cout.unsetf(std::ios::floatfield);
+    }
+
+    bool writeJson(const std::string& path) const {
+        std::ofstream out(path);
+        if (!out) return false;
+
+        out << std::fixed << std::setprecision(4);
+        out << "{\n  \"makespan_ms\": " << makespan << ",\n  \"threads\": " << threads.size()
+            << ",\n  \"processors\": [";
+        for (size_t i = 0; i < processors.size(); ++i) {
+            out << (i ? "," : "") << "\n    {\"id\": " << i << ", \"busy_ms\": " << processors[i].busyMs
+                << ", \"idle_ms\": " << idleMs(i) << ", \"utilization\": " << utilization(i)
+                << ", \"dispatches\": " << processors[i].dispatches
+                << ", \"switch_ms\": " << processors[i].switchUs / 1000.0
+                << ", \"refill_ms\": " << processors[i].refillUs / 1000.0 << "}";
+        }
+        out << "\n  ],\n  \"latency\": {";
+        writeHistogramJson(out, "turnaround_ms", turnaround, true);
+        writeHistogramJson(out, "waiting_ms", waiting, false);
+        writeHistogramJson(out, "response_ms", response, false);
+        writeHistogramJson(out, "preemptions", preemptions, false);
+        out << "\n  }\n}\n";
+        return static_cast<bool>(out);
+    }
+
+    // One row per thread.
+    bool writeCsv(const std::string& path) const {
+        std::ofstream out(path);
+        if (!out) return false;
+
+        out << "id,name,arrival_ms,first_run_ms,completion_ms,burst_ms,turnaround_ms,waiting_ms,"
+               "response_ms,preemptions,migrations\n";
+        for (const auto& r : threads) {
+            out << r.id << "," << threadLabel(r.id, r.nameId) << "," << r.arrival << "," << r.firstRun << "," << r.completion
+                << "," << r.burst << "," << r.turnaround() << "," << r.waiting << "," << r.response()
+                << "," << r.preemptions << "," << r.migrations << "\n";
+        }
+        return static_cast<bool>(out);
+    }
+
+private:
+    long long idleMs(size_t i) const { return std::max(0LL, makespan - processors[i].busyMs); }
+
+    double utilization(size_t i) const {
+        return makespan > 0 ? static_cast<double>(processors[i].busyMs) / makespan : 0.0;
+    }
+
+    static void printRow(const char* label, const LatencyHistogram& h) {
+        std::cout << std::left << std::setw(16) << label << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(10) << h.mean() << std::setw(10) << h.percentile(0.50) << std::setw(10)
+                  << h.percentile(0.99) << std::setw(10) << h.percentile(0.999) << "\n";
+        std::cout.unsetf(std::ios::floatfield);
+    }
+
+    static void writeHistogramJson(std::ofstream& out, const char* key, const LatencyHistogram& h, bool first) {
+        out << (first ? "" : ",") << "\n    \"" << key << "\": {\"mean\": " << h.mean()
+            << ", \"p50\": " << h.percentile(0.50) << ", \"p99\": " << h.percentile(0.99)
+            << ", \"p999\": " << h.percentile(0.999) << ", \"log2_buckets\": [";
+        auto counts = h.buckets();
+        for (size_t k = 0; k < counts.size(); ++k) out << (k ? ", " : "") << counts[k];
+        out << "]}";
+    }
+
+    std::vector<ProcessorMetrics> processors;
+    std::vector<ThreadRecord> threads;
+    long long makespan = 0;
+
+    LatencyHistogram turnaround;
+    LatencyHistogram waiting;
+    LatencyHistogram response;
+    LatencyHistogram preemptions;
+};
+
+#endif // SIM_METRICS_HPP
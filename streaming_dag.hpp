@@ -0,0 +1,253 @@
+// streaming_dag.hpp
+#ifndef STREAMING_DAG_HPP
+#define STREAMING_DAG_HPP
+
+#include <iostream>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <unordered_set>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <algorithm>
+
+#include "dag_scheduler.hpp"
+
+// A DAG that grows while it runs. Subtasks and edges may be added from any thread, including
+// from inside a running subtask, so a stage can fan out over the items it has just produced.
+// A subtask is dispatched onto the pool as soon as its last dependency finishes, or when it is
+// added if there is none; there is no separate start call. Once seal() is called no more
+// subtasks may be added, and the run ends when everything added has finished.
+//
+//     StreamingDAG dag(pool);
+//     dag.add(SubTask{1, [&dag]() { for (int item : produce()) dag.add(SubTask{...}); }, {}, 1.0, nullptr});
+//     dag.seal();   // or from a subtask, once it knows the graph is complete
+//     dag.wait();
+//
+// Edges only ever point at subtasks that have not started, so a dependency added to a running
+// DAG can never be missed. Unlike CompiledDAG there is no whole graph to rank up front: ready
+// subtasks run in release order, and the shape is guarded by one mutex, held only for the
+// bookkeeping and never while a subtask runs.
+class StreamingDAG {
+public:
+    explicit StreamingDAG(WorkStealingPool& workers = WorkStealingPool::shared()) : pool(&workers) {}
+
+    StreamingDAG(const StreamingDAG&) = delete;
+    StreamingDAG& operator=(const StreamingDAG&) = delete;
+
+    void setVerbose(bool v) { verbose = v; }
+
+    // Adds a subtask whose dependencies are subtasks already added (finished ones count as
+    // satisfied). Throws std::invalid_argument on a duplicate or unknown id or a subtask with no
+    // work, and std::logic_error once sealed.
+    void add(SubTask task) {
+        bool ready;
+        Node* node;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (sealed) throw std::logic_error("subtask " + std::to_string(task.id) + " added to a sealed DAG");
+            if (index.count(task.id)) throw std::invalid_argument("duplicate subtask id " + std::to_string(task.id));
+            if (!task.work && !task.coroutine) {
+                throw std::invalid_argument("subtask " + std::to_string(task.id) + " has no work");
+            }
+            std::vector<Node*> parents;
+            parents.reserve(task.dependencies.size());
+            for (int dep : task.dependencies) {
+                auto it = index.find(dep);
+                if (it == index.end()) {
+                    throw std::invalid_argument("subtask " + std::to_string(task.id) +
+                                                " depends on unknown subtask " + std::to_string(dep));
+                }
+                parents.push_back(it->second);
+            }
+
+            if (nodes.empty()) runStart = std::chrono::steady_clock::now();
+            nodes.emplace_back();
+            node = &nodes.back();
+            node->id = task.id;
+            node->work = std::move(task.work);
+            node->coroutine = std::move(task.coroutine);
+            index.emplace(task.id, node);
+            ++outstanding;
+            for (Node* parent : parents) link(parent, node);
+            ready = node->indegree == 0;
+            if (ready) node->state = State::Dispatched;
+        }
+        if (ready) dispatch(node);
+    }
+
+    // Makes `after` wait for `before`. `after` must not have started; throws std::invalid_argument
+    // for unknown ids or an edge that would close a cycle, std::logic_error if `after` already runs.
+    void addDependency(int before, int after) {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto from = index.find(before);
+        auto to = index.find(after);
+        if (from == index.end() || to == index.end()) {
+            throw std::invalid_argument("dependency between unknown subtasks " + std::to_string(before) + " -> " +
+                                        std::to_string(after));
+        }
+        if (to->second->state != State::Waiting) {
+            throw std::logic_error("subtask " + std::to_string(after) + " has already started");
+        }
+        if (reaches(to->second, from->second)) {
+            throw std::invalid_argument("dependency " + std::to_string(before) + " -> " + std::to_string(after) +
+                                        " would create a cycle");
+        }
+        link(from->second, to->second);
+    }
+
+    // No more subtasks will be added. Safe to call from inside a subtask.
+    void seal() {
+        std::unique_lock<std::mutex> lock(mtx);
+        if (sealed) return;
+        sealed = true;
+        if (outstanding == 0) drain(lock);
+    }
+
+    // Seals the DAG; `done` runs once it has drained, on the worker that finishes the last
+    // subtask (or here, if nothing is left). It may destroy this DAG.
+    void sealAsync(SubTask::Work done) {
+        std::unique_lock<std::mutex> lock(mtx);
+        onDrained = std::move(done);
+        if (sealed) {
+            if (drained) {
+                auto callback = std::move(onDrained);
+                lock.unlock();
+                callback();
+            }
+            return;
+        }
+        sealed = true;
+        if (outstanding == 0) drain(lock);
+    }
+
+    // Blocks until the DAG is sealed and drained. Must not be called from one of the pool's workers.
+    void wait() {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [this]() { return drained; });
+    }
+
+    // Valid once drained. estimatedCriticalPath and plannedMakespan stay 0: the graph was
+    // never known in full before it ran.
+    const DAGRunReport& report() const { return lastRun; }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        return nodes.size();
+    }
+
+private:
+    enum class State { Waiting, Dispatched, Done };
+
+    struct Node {
+        int id = 0;
+        SubTask::Work work;
+        SubTask::Coroutine coroutine;  // Kept alive until the run drains, like CompiledDAG's
+        std::vector<Node*> successors;
+        int indegree = 0;
+        State state = State::Waiting;
+        double measuredMs = 0;
+        double longestBeforeMs = 0;  // Longest measured chain of finished ancestors
+    };
+
+    // Counts the edge unless the parent has already finished. Caller holds mtx.
+    void link(Node* parent, Node* child) {
+        if (parent->state == State::Done) {
+            child->longestBeforeMs = std::max(child->longestBeforeMs, parent->longestBeforeMs + parent->measuredMs);
+            return;
+        }
+        parent->successors.push_back(child);
+        ++child->indegree;
+    }
+
+    // Whether `to` is a transitive successor of `from` (or `from` itself). Caller holds mtx.
+    bool reaches(Node* from, Node* to) const {
+        std::vector<Node*> stack{from};
+        std::unordered_set<Node*> seen;
+        while (!stack.empty()) {
+            Node* n = stack.back();
+            stack.pop_back();
+            if (n == to) return true;
+            if (!seen.insert(n).second) continue;
+            stack.insert(stack.end(), n->successors.begin(), n->successors.end());
+        }
+        return false;
+    }
+
+    // id, work and coroutine never change once the node is added, so the job reads them
+    // without the lock.
+    void dispatch(Node* node) {
+        pool->submit([this, node]() {
+            runSubtaskJob(
+                node->id, traceScope, verbose, static_cast<bool>(node->coroutine), [node]() { node->work(); },
+                [node]() { return node->coroutine(); },
+                [this, node](std::chrono::steady_clock::time_point started) { this->finishSubtask(node, started); });
+        });
+    }
+
+    void finishSubtask(Node* node, std::chrono::steady_clock::time_point started) {
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+        if (verbose) std::cout << "Subtask " << node->id << " finished\n";
+
+        std::vector<Node*> ready;
+        std::unique_lock<std::mutex> lock(mtx);
+        node->measuredMs = ms;
+        node->state = State::Done;
+        lastRun.totalWorkMs += ms;
+        const double chain = node->longestBeforeMs + ms;
+        lastRun.criticalPathMs = std::max(lastRun.criticalPathMs, chain);
+        for (Node* child : node->successors) {
+            child->longestBeforeMs = std::max(child->longestBeforeMs, chain);
+            if (--child->indegree == 0) {
+                child->state = State::Dispatched;
+                ready.push_back(child);
+            }
+        }
+        node->successors.clear();
+        node->successors.shrink_to_fit();
+
+        // Nothing may be read from the DAG after the drain except by this thread.
+        if (--outstanding == 0 && sealed) {
+            drain(lock);
+            return;
+        }
+        lock.unlock();
+        for (Node* child : ready) dispatch(child);
+    }
+
+    // Ends the run: fills in the report, then hands over to sealAsync()'s callback or wait().
+    void drain(std::unique_lock<std::mutex>& lock) {
+        lastRun.workers = pool->size();
+        if (!nodes.empty()) {
+            lastRun.makespanMs = std::chrono::duration<double, std::milli>(
+                                     std::chrono::steady_clock::now() - runStart).count();
+        }
+        drained = true;
+        if (onDrained) {
+            auto done = std::move(onDrained);
+            lock.unlock();
+            done();
+            return;
+        }
+        cv.notify_all();
+    }
+
+    WorkStealingPool* pool;
+    mutable std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<Node> nodes;  // Never moves an element, so Node* stays valid while it grows
+    std::unordered_map<int, Node*> index;
+    int outstanding = 0;     // Added but not finished
+    bool sealed = false;
+    bool drained = false;
+    bool verbose = true;     // Per-subtask console output
+    SubTask::Work onDrained;
+    DAGRunReport lastRun;
+    std::chrono::steady_clock::time_point runStart;
+    const uint32_t traceScope = Tracer::newScope();
+};
+
+#endif // STREAMING_DAG_HPP
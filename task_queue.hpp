@@ -0,0 +1,121 @@
+// task_queue.hpp
+#ifndef TASK_QUEUE_HPP
+#define TASK_QUEUE_HPP
+
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+
+#include "dag_scheduler.hpp"
+#include "mpmc_queue.hpp"
+
+// A unit of work for the multiprocessor environment: one run of a DAG.
+struct Task {
+    int id;
+    std::shared_ptr<CompiledDAG> graph;  // Shared by every Task with the same pipeline shape
+};
+
+// Bounded lock-free ring of Tasks. Producers block (backpressure) while it is full.
+class TaskQueue {
+private:
+    BoundedMPMCQueue<Task> queue;
+
+public:
+    explicit TaskQueue(size_t capacity = 1024) : queue(capacity) {}
+
+    bool push(Task task) {
+        return queue.push(std::move(task));
+    }
+
+    // Moves all tasks in, blocking whenever the queue is full.
+    size_t push_bulk(std::vector<Task>& tasks) {
+        return queue.push_bulk(tasks.data(), tasks.size());
+    }
+
+    bool pop(Task& task) {
+        return queue.pop(task);
+    }
+
+    // Never blocks; false when the queue is empty.
+    bool try_pop(Task& task) {
+        return queue.try_pop(task);
+    }
+
+    // Blocks until at least one task is available and takes up to `max`.
+    // Returns an empty batch once the queue is shut down and drained.
+    size_t pop_bulk(std::vector<Task>& batch, size_t max) {
+        batch.resize(max);
+        size_t n = queue.pop_bulk(batch.data(), max);
+        batch.resize(n);
+        return n;
+    }
+
+    void shutdown() {
+        queue.close();
+    }
+};
+
+// A Task whose DAG is in flight. Every subtask's work receives the RunningTask as its context.
+struct RunningTask {
+    int taskId;
+    int processor;
+    DAGScheduler dag;
+
+    RunningTask(Task&& t, int processor) : taskId(t.id), processor(processor), dag(std::move(t.graph), this) {}
+};
+
+// Free list of RunningTasks. A finished one is handed to the next Task as is, its DAGScheduler
+// rebound to the new graph, so once as many Tasks have been in flight at once as ever will be,
+// starting a Task allocates nothing.
+class RunningTaskPool {
+private:
+    std::mutex mtx;
+    std::vector<std::unique_ptr<RunningTask>> all;
+    std::vector<RunningTask*> free;  // Never shorter than `all`, so release() does not allocate
+
+public:
+    RunningTask* acquire(Task&& task, int processor) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (free.empty()) {
+            all.push_back(std::make_unique<RunningTask>(std::move(task), processor));
+            free.reserve(all.size());
+            return all.back().get();
+        }
+        RunningTask* running = free.back();
+        free.pop_back();
+        running->taskId = task.id;
+        running->processor = processor;
+        running->dag.setGraph(std::move(task.graph));
+        return running;
+    }
+
+    // Valid from the DAG's completion callback: the scheduler is not touched after it returns.
+    void release(RunningTask* running) {
+        std::lock_guard<std::mutex> lock(mtx);
+        free.push_back(running);
+    }
+};
+
+// Counts down once per finished task; wait() returns as soon as the last one is done.
+class CompletionLatch {
+private:
+    std::mutex mtx;
+    std::condition_variable cv;
+    int remaining;
+
+public:
+    explicit CompletionLatch(int count) : remaining(count) {}
+
+    void countDown() {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (--remaining == 0) cv.notify_all();
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [this]() { return remaining <= 0; });
+    }
+};
+
+#endif // TASK_QUEUE_HPP
@@ -0,0 +1,626 @@
+// thread_scheduler.hpp
+#ifndef THREAD_SCHEDULER_HPP
+#define THREAD_SCHEDULER_HPP
+
+#include <iostream>
+#include <queue>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <iomanip>
+#include <ctime>
+#include <string>
+#include <stdexcept>
+#include <algorithm>
+#include <memory>
+#include <atomic>
+#include <cmath>
+
+#include "sched_policy.hpp"
+#include "sim_metrics.hpp"
+#include "trace.hpp"
+#include "workload.hpp"
+#include "cpu_topology.hpp"
+#include "cost_model.hpp"
+
+// Utility to get current time string (only called for console output)
+inline std::string currentTime() {
+    auto now = std::chrono::system_clock::now();
+    std::time_t t = std::chrono::system_clock::to_time_t(now);
+    std::tm now_tm;
+    localtime_r(&t, &now_tm);  // std::localtime shares a static buffer between threads
+
+    char buffer[10];
+    std::strftime(buffer, sizeof(buffer), "%H:%M:%S", &now_tm);
+    return std::string(buffer);
+}
+
+class ThreadScheduler {
+public:
+    // Global: every processor shares taskQueue under queueMutex.
+    // PerProcessor: each processor has its own run queue, preempted threads go back to the
+    // processor that ran them, and idle processors steal from the others.
+    enum class QueueMode { Global, PerProcessor };
+
+private:
+    PolicyKind policyKind;
+    std::unique_ptr<SchedPolicy> taskQueue;  // Ordered by the scheduling policy
+    std::mutex queueMutex;
+    std::condition_variable cv;
+    bool done = false;
+
+    struct LocalRunQueue {
+        std::mutex mtx;
+        std::unique_ptr<SchedPolicy> threads;
+    };
+    std::vector<std::unique_ptr<LocalRunQueue>> localQueues;
+    bool localQueuesReady = false;          // Guarded by queueMutex
+    std::atomic<int> queuedThreads{0};      // Threads sitting in any local queue
+    std::atomic<int> idleProcessors{0};
+    size_t nextLocalQueue = 0;
+
+    // Real-thread runs only: where each processor thread runs and, in per-processor mode, the
+    // order it steals in.
+    bool pinProcessors = false;
+    CpuTopology topology;
+    WorkerAffinity affinity;
+
+    // Contention counters, reported after each run
+    std::atomic<long long> steals{0};
+    std::atomic<long long> migrations{0};
+    std::atomic<long long> lockWaitNs{0};
+
+    // Indexed by processor; each processor only appends to its own entry. Only verbose runs,
+    // which print every dispatch, record them; the rest count them in ProcessorMetrics.
+    struct Dispatch {
+        int id;
+        uint32_t nameId;  // See NameTable
+    };
+    std::vector<std::vector<Dispatch>> processorAssignments;
+    std::mutex printMutex;
+    int timeQuantum;  // Time slice for Round Robin scheduling
+    bool verbose = true;  // Per-event console output
+    bool summaries = true;  // End-of-run reports
+    QueueMode queueMode = QueueMode::Global;
+
+    SimMetrics runMetrics;
+    std::chrono::steady_clock::time_point runStart;
+    bool virtualRun = false;  // Trace timestamps come from the simulated clock
+
+    CostModel costModel;                  // Charged by runSimulated() only
+    std::vector<long long> overheadCarryUs;  // Per processor: cost not yet charged as a whole ms
+    int finalQuantum = 0;
+
+    // Discrete-event engine state for runSimulated()
+    enum class EventType { Arrival, QuantumExpiry, Completion };
+
+    struct Event {
+        long long time;
+        long long seq;  // Insertion order; breaks ties so runs are deterministic
+        EventType type;
+        int processor;
+
+        bool operator>(const Event& other) const {
+            return time != other.time ? time > other.time : seq > other.seq;
+        }
+    };
+
+public:
+    ThreadScheduler(int tq, PolicyKind policy = PolicyKind::RoundRobin)
+        : policyKind(policy), taskQueue(makePolicy(policy)), timeQuantum(tq) {}
+
+    // Threads already added are moved into the new policy's queue.
+    void setPolicy(PolicyKind policy) {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        auto next = makePolicy(policy);
+        SimThread t(0, "", 0);
+        while (taskQueue->pop(t))
+            next->push(t);
+        taskQueue = std::move(next);
+        policyKind = policy;
+    }
+
+    void setVerbose(bool v) { verbose = v; }
+    void setSummaries(bool s) { summaries = s; }
+    void setQueueMode(QueueMode mode) { queueMode = mode; }
+
+    // Pins each processor thread of runWithProcessors() to its own core (see
+    // CpuTopology::placement) and makes idle processors steal from the nearest ones first.
+    // runSimulated() has no OS threads and ignores it.
+    void setPinning(bool pin) { pinProcessors = pin; }
+
+    void setCostModel(const CostModel& model) { costModel = model; }
+    void setQuantum(int ms) { timeQuantum = ms; }
+
+    // Timing results of the last completed run.
+    const SimMetrics& metrics() const { return runMetrics; }
+    long long migrationCount() const { return migrations.load(); }
+    int lastQuantum() const { return finalQuantum; }  // Base quantum at the end of the last virtual run
+
+    void addThread(const SimThread& t) {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (localQueuesReady) {
+            pushLocal(localQueueFor(t), t);
+        } else {
+            taskQueue->push(t);
+        }
+        if (verbose)
+            std::cout << "[+] Added thread " << t.label() << " with burst time: " << t.burstTime << "ms\n";
+        cv.notify_one();
+    }
+
+    void runWithProcessors(int numProcessors) {
+        requireProcessors(numProcessors);
+        std::vector<std::thread> processors;
+        resetCounters();
+        resetAssignments(numProcessors);
+        runMetrics.reset(numProcessors);
+        runStart = std::chrono::steady_clock::now();
+        virtualRun = false;
+        if (queueMode == QueueMode::PerProcessor) {
+            distributeToLocalQueues(numProcessors);
+        }
+        affinity = {};
+        if (pinProcessors) {
+            topology = CpuTopology::detect();
+            affinity = topology.affinityFor(numProcessors);
+            std::cout << "Topology:\n" << topology.summary();
+        } else {
+            affinity.stealOrder.assign(numProcessors, {});
+            for (int i = 0; i < numProcessors; ++i) {
+                for (int k = 1; k < numProcessors; ++k) affinity.stealOrder[i].push_back((i + k) % numProcessors);
+            }
+        }
+
+        for (int i = 0; i < numProcessors; ++i) {
+            processors.emplace_back([this, i]() {
+                if (pinProcessors && !pinCurrentThread(affinity.cpus[i])) {
+                    std::lock_guard<std::mutex> lock(printMutex);
+                    std::cerr << "warning: could not pin P" << i << " to cpu " << affinity.cpus[i] << "\n";
+                }
+                while (true) {
+                    SimThread t(0, "", 0);
+                    bool gotThread = queueMode == QueueMode::PerProcessor ? acquireLocal(i, t)
+                                                                          : acquireGlobal(t);
+                    if (!gotThread)
+                        return;
+
+                    long long sliceStart = elapsedMs();
+                    beginSlice(i, t, sliceStart);
+
+                    if (verbose) {
+                        std::lock_guard<std::mutex> lock(printMutex);
+                        std::cout << "[" << currentTime() << "] [P" << i << "] Assigned: " << t.label()
+                                  << " (burst: " << t.burstTime << "ms)\n";
+                    }
+
+                    // Run for the time quantum or remaining time, whichever is smaller
+                    SchedPolicy& policy = policyFor(i);
+                    int quantum = policy.quantumFor(t, timeQuantum);
+                    int timeToRun = std::min(quantum, t.remainingBurstTime);
+                    std::this_thread::sleep_for(std::chrono::milliseconds(timeToRun));
+                    t.remainingBurstTime -= timeToRun;
+                    policy.onRan(t, timeToRun, quantum);
+                    long long sliceEnd = elapsedMs();
+                    endSlice(i, t, sliceEnd, sliceEnd - sliceStart);
+
+                    // If there is remaining burst time, push it back into the queue
+                    if (t.remainingBurstTime > 0) {
+                        if (queueMode == QueueMode::PerProcessor) {
+                            pushLocal(i, t);
+                            wakeIdleProcessor();
+                        } else {
+                            auto lock = timedLock(queueMutex);
+                            taskQueue->push(t);
+                        }
+                        if (verbose) {
+                            std::lock_guard<std::mutex> lock(printMutex);
+                            std::cout << "[" << currentTime() << "] [P" << i << "] Preempted: " << t.label()
+                                      << " (remaining burst: " << t.remainingBurstTime << "ms)\n";
+                        }
+                    } else {
+                        if (verbose) {
+                            std::lock_guard<std::mutex> lock(printMutex);
+                            std::cout << "[" << currentTime() << "] [P" << i << "] Completed: " << t.label() << "\n";
+                        }
+                    }
+                }
+            });
+        }
+
+        for (auto& p : processors)
+            p.join();
+        {
+            // The local queues are drained; threads added from now on wait in the shared
+            // queue for the next run, which builds its own local queues.
+            std::lock_guard<std::mutex> lock(queueMutex);
+            localQueuesReady = false;
+        }
+
+        runMetrics.finish(elapsedMs());
+        if (!summaries)
+            return;
+        printAssignmentSummary(numProcessors);
+        printQueueStats();
+        if (pinProcessors)
+            printCoreThroughput(numProcessors);
+        runMetrics.printSummary();
+    }
+
+    // Discrete-event version of runWithProcessors(): a burst advances a virtual clock instead of
+    // sleeping, so the run is deterministic and takes no wall-clock time. Threads already added
+    // arrive at their arrivalTime; same-time events are handled in the order they were scheduled.
+    void runSimulated(int numProcessors) {
+        requireProcessors(numProcessors);  // Before the queue is drained
+        std::vector<SimThread> added;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            SimThread t(0, "", 0);
+            while (taskQueue->pop(t))
+                added.push_back(t);
+        }
+        VectorArrivalSource source(std::move(added));
+        runSimulated(numProcessors, source);
+    }
+
+    // Same, with arrivals pulled from `source` one at a time as the clock reaches them, so a
+    // trace is never held in memory. A thread with an affinity only runs on that processor
+    // (modulo numProcessors); an idle processor serves its pinned threads before the shared queue.
+    // Dispatches cost what setCostModel() says: a slice starts late by its switch and refill
+    // cost, and the lost capacity is reported with the metrics.
+    void runSimulated(int numProcessors, ArrivalSource& source) {
+        requireProcessors(numProcessors);
+        resetCounters();
+        resetAssignments(numProcessors);
+        runMetrics.reset(numProcessors);
+        virtualRun = true;
+        overheadCarryUs.assign(numProcessors, 0);
+        AdaptiveQuantum adaptive(timeQuantum, costModel.switchUs);
+
+        std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+        long long seq = 0;
+        long long now = 0;
+
+        // Only the next pending arrival is kept in the event queue.
+        SimThread pending(0, "", 0);
+        auto scheduleArrival = [&]() {
+            if (source.next(pending))
+                events.push(Event{pending.arrivalTime, seq++, EventType::Arrival, -1});
+        };
+        scheduleArrival();
+
+        auto readyQueue = makePolicy(policyKind);
+        std::vector<std::unique_ptr<SchedPolicy>> pinned(numProcessors);  // Created on first use
+        std::vector<SimThread> running(numProcessors, SimThread(0, "", 0));
+        std::vector<bool> busy(numProcessors, false);
+        std::vector<long long> sliceStart(numProcessors, 0);
+        long long pinnedCount = 0;
+
+        auto makeReady = [&](const SimThread& t) {
+            if (t.affinity < 0) {
+                readyQueue->push(t);
+                return;
+            }
+            auto& queue = pinned[t.affinity % numProcessors];
+            if (!queue) queue = makePolicy(policyKind);
+            queue->push(t);
+            ++pinnedCount;
+        };
+
+        auto dispatch = [&]() {
+            for (int p = 0; p < numProcessors && (!readyQueue->empty() || pinnedCount > 0); ++p) {
+                if (busy[p]) continue;
+
+                SchedPolicy* queue = readyQueue.get();
+                if (pinned[p] && !pinned[p]->empty()) {
+                    queue = pinned[p].get();
+                    --pinnedCount;
+                } else if (readyQueue->empty()) {
+                    continue;
+                }
+
+                SimThread& t = running[p];
+                queue->tick(now);
+                queue->pop(t);
+                busy[p] = true;
+                sliceStart[p] = now;
+                const int previousProcessor = t.lastProcessor;
+                beginSlice(p, t, now);
+                const long long overheadMs = chargeDispatch(p, t, previousProcessor, now);
+
+                if (verbose) {
+                    std::cout << "[" << std::setw(8) << now << "ms] [P" << p << "] Assigned: " << t.label()
+                              << " (burst: " << t.burstTime << "ms)\n";
+                }
+
+                int quantum = queue->quantumFor(t, costModel.adaptiveQuantum ? adaptive.quantum() : timeQuantum);
+                int timeToRun = std::min(quantum, t.remainingBurstTime);
+                t.remainingBurstTime -= timeToRun;
+                queue->onRan(t, timeToRun, quantum);
+                EventType type = t.remainingBurstTime > 0 ? EventType::QuantumExpiry : EventType::Completion;
+                events.push(Event{now + overheadMs + timeToRun, seq++, type, p});
+            }
+        };
+
+        while (!events.empty()) {
+            Event e = events.top();
+            events.pop();
+            now = e.time;
+
+            switch (e.type) {
+            case EventType::Arrival:
+                makeReady(pending);
+                scheduleArrival();
+                break;
+            case EventType::QuantumExpiry:
+                endSlice(e.processor, running[e.processor], now, now - sliceStart[e.processor]);
+                makeReady(running[e.processor]);
+                busy[e.processor] = false;
+                if (verbose) {
+                    std::cout << "[" << std::setw(8) << now << "ms] [P" << e.processor << "] Preempted: "
+                              << running[e.processor].label() << " (remaining burst: "
+                              << running[e.processor].remainingBurstTime << "ms)\n";
+                }
+                break;
+            case EventType::Completion:
+                endSlice(e.processor, running[e.processor], now, now - sliceStart[e.processor]);
+                busy[e.processor] = false;
+                if (costModel.adaptiveQuantum)
+                    adaptive.observe(running[e.processor].burstTime);
+                if (verbose) {
+                    std::cout << "[" << std::setw(8) << now << "ms] [P" << e.processor << "] Completed: "
+                              << running[e.processor].label() << "\n";
+                }
+                break;
+            }
+
+            dispatch();
+        }
+
+        runMetrics.finish(now);
+        finalQuantum = costModel.adaptiveQuantum ? adaptive.quantum() : timeQuantum;
+        if (!summaries)
+            return;
+        std::cout << "\nSimulated makespan (" << readyQueue->name() << "): " << now << "ms\n";
+        printAssignmentSummary(numProcessors);
+        std::cout << "Migrations: " << migrations.load() << "\n";
+        if (!costModel.free()) {
+            std::cout << "Cost model: " << costModel.switchUs << "us per switch, " << costModel.migrationUs
+                      << "us per migration";
+            if (costModel.cacheHalfLifeMs > 0)
+                std::cout << " (cache half-life " << costModel.cacheHalfLifeMs << "ms)";
+            std::cout << "\n";
+        }
+        if (costModel.adaptiveQuantum) {
+            std::cout << "Adaptive quantum: " << adaptive.quantum() << "ms at the end, "
+                      << adaptive.lowestQuantum() << "-" << adaptive.highestQuantum() << "ms during the run\n";
+        }
+        runMetrics.printSummary();
+    }
+
+    void printAssignmentSummary(int numProcessors) {
+        std::cout << "\n=== Processor Assignment Summary ===\n";
+        for (int i = 0; i < numProcessors; ++i) {
+            std::cout << "Processor P" << i << " handled: ";
+            if (runMetrics.processor(i).dispatches == 0) {
+                std::cout << "None";
+            } else if (!verbose) {
+                std::cout << runMetrics.processor(i).dispatches << " dispatches";
+            } else {
+                for (const Dispatch& d : processorAssignments[i]) {
+                    std::cout << threadLabel(d.id, d.nameId) << " ";
+                }
+            }
+            std::cout << "\n";
+        }
+    }
+
+    void printQueueStats() {
+        std::cout << "\n=== Run Queue Stats ("
+                  << (queueMode == QueueMode::PerProcessor ? "per-processor" : "global") << ", "
+                  << taskQueue->name() << ") ===\n"
+                  << "Steals: " << steals.load() << "\n"
+                  << "Migrations: " << migrations.load() << "\n"
+                  << "Lock wait: " << lockWaitNs.load() / 1000 << "us\n";
+    }
+
+    // Per-processor work of a pinned run, by the core it ran on.
+    void printCoreThroughput(int numProcessors) {
+        const double seconds = std::max<long long>(runMetrics.makespanMs(), 1) / 1000.0;
+        std::cout << "\n=== Per-Core Throughput ===\n" << std::fixed << std::setprecision(1);
+        for (int i = 0; i < numProcessors; ++i) {
+            const ProcessorMetrics& m = runMetrics.processor(i);
+            std::cout << "P" << i << " on " << topology.describe(affinity.cpus[i]) << ": " << m.dispatches
+                      << " dispatches, " << m.completed.size() << " completed, "
+                      << m.dispatches / seconds << " dispatches/s\n";
+        }
+        std::cout.unsetf(std::ios::floatfield);
+    }
+
+    void markDone() {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        done = true;
+        cv.notify_all();
+    }
+
+private:
+    long long elapsedMs() const {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now() - runStart).count();
+    }
+
+    // Per-thread accounting shared by both engines; times are ms on the run's clock.
+    // Each processor only writes its own ProcessorMetrics, so none of this takes a lock.
+    void beginSlice(int p, SimThread& t, long long now) {
+        ++runMetrics.processor(p).dispatches;
+        if (verbose) processorAssignments[p].push_back(Dispatch{t.id, t.nameId});
+        if (t.firstRunTime < 0)
+            t.firstRunTime = now;
+        t.waitingTime += now - t.readySince;
+        if (t.lastProcessor != -1 && t.lastProcessor != p) {
+            ++t.migrations;
+            migrations.fetch_add(1, std::memory_order_relaxed);
+        }
+        t.lastProcessor = p;
+        traceSlice(TraceEvent::SliceBegin, p, t.id, now);
+    }
+
+    void endSlice(int p, SimThread& t, long long now, long long ran) {
+        ProcessorMetrics& m = runMetrics.processor(p);
+        m.busyMs += ran;
+        if (t.remainingBurstTime > 0) {
+            ++t.preemptions;
+            t.readySince = now;
+            traceSlice(TraceEvent::SlicePreempt, p, t.id, now);
+        } else {
+            t.completionTime = now;
+            m.completed.push_back(ThreadRecord::from(t));
+            traceSlice(TraceEvent::SliceComplete, p, t.id, now);
+        }
+    }
+
+    // Charges the cost model for dispatching t on p (its previous slice ran on
+    // previousProcessor) and returns the whole ms the slice starts late by; the rest carries over.
+    long long chargeDispatch(int p, const SimThread& t, int previousProcessor, long long now) {
+        if (costModel.free()) return 0;
+        ProcessorMetrics& m = runMetrics.processor(p);
+        long long costUs = costModel.switchUs;
+        m.switchUs += costModel.switchUs;
+        if (previousProcessor != -1 && previousProcessor != p) {
+            const long long refillUs = std::llround(costModel.migrationCostUs(now - t.readySince));
+            m.refillUs += refillUs;
+            costUs += refillUs;
+        }
+        overheadCarryUs[p] += costUs;
+        const long long ms = overheadCarryUs[p] / 1000;
+        overheadCarryUs[p] %= 1000;
+        return ms;
+    }
+
+    void traceSlice(TraceEvent type, int p, int id, long long nowMs) const {
+        if (!Tracer::enabled()) return;
+        Tracer::emitAt(virtualRun ? static_cast<uint64_t>(nowMs) * 1000000 : Tracer::nowNs(), type, p, id);
+    }
+
+    // Acquires m, adding the time spent blocked to lockWaitNs when it was contended.
+    std::unique_lock<std::mutex> timedLock(std::mutex& m) {
+        std::unique_lock<std::mutex> lock(m, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            auto start = std::chrono::steady_clock::now();
+            lock.lock();
+            lockWaitNs.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now() - start).count(),
+                                 std::memory_order_relaxed);
+        }
+        return lock;
+    }
+
+    bool acquireGlobal(SimThread& t) {
+        auto lock = timedLock(queueMutex);
+        cv.wait(lock, [this]() { return !taskQueue->empty() || done; });
+
+        if (taskQueue->empty() && done)
+            return false;
+
+        taskQueue->tick(elapsedMs());
+        taskQueue->pop(t);
+        return true;
+    }
+
+    static void requireProcessors(int numProcessors) {
+        if (numProcessors < 1)
+            throw std::invalid_argument("need at least one processor, got " + std::to_string(numProcessors));
+    }
+
+    // Keeps each processor's capacity from earlier runs, so a repeated run records its
+    // dispatches without growing the vectors again.
+    void resetAssignments(int numProcessors) {
+        processorAssignments.resize(numProcessors);
+        for (auto& dispatches : processorAssignments) dispatches.clear();
+    }
+
+    // The contention counters describe one run.
+    void resetCounters() {
+        steals = 0;
+        migrations = 0;
+        lockWaitNs = 0;
+    }
+
+    // Moves everything added so far into the local queues, round robin.
+    void distributeToLocalQueues(int numProcessors) {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        localQueues.clear();
+        for (int i = 0; i < numProcessors; ++i)
+            localQueues.push_back(std::make_unique<LocalRunQueue>());
+        for (auto& q : localQueues)
+            q->threads = makePolicy(policyKind);
+        localQueuesReady = true;
+        nextLocalQueue = 0;
+        SimThread t(0, "", 0);
+        while (taskQueue->pop(t))
+            pushLocal(localQueueFor(t), t);
+    }
+
+    // Round robin, or the thread's affinity. This is only the initial placement: stealing
+    // may still move the thread.
+    size_t localQueueFor(const SimThread& t) {
+        if (t.affinity >= 0) return t.affinity % localQueues.size();
+        return nextLocalQueue++ % localQueues.size();
+    }
+
+    void pushLocal(size_t i, const SimThread& t) {
+        {
+            auto lock = timedLock(localQueues[i]->mtx);
+            localQueues[i]->threads->push(t);
+        }
+        queuedThreads.fetch_add(1);
+    }
+
+    // Lets a sleeping processor steal a thread that was just re-queued locally.
+    void wakeIdleProcessor() {
+        if (idleProcessors.load() > 0) {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            cv.notify_one();
+        }
+    }
+
+    SchedPolicy& policyFor(int i) {
+        return queueMode == QueueMode::PerProcessor ? *localQueues[i]->threads : *taskQueue;
+    }
+
+    // Own queue first, in policy order, then steal from the others: nearest cores first when
+    // pinned, otherwise round robin from the next processor on (both set up when the run starts).
+    bool acquireLocal(int i, SimThread& t) {
+        const std::vector<unsigned>& victims = affinity.stealOrder[i];
+        while (true) {
+            {
+                auto lock = timedLock(localQueues[i]->mtx);
+                localQueues[i]->threads->tick(elapsedMs());
+                if (localQueues[i]->threads->pop(t)) {
+                    queuedThreads.fetch_sub(1);
+                    return true;
+                }
+            }
+            for (unsigned v : victims) {
+                auto lock = timedLock(localQueues[v]->mtx);
+                localQueues[v]->threads->tick(elapsedMs());
+                if (localQueues[v]->threads->steal(t)) {
+                    queuedThreads.fetch_sub(1);
+                    steals.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+
+            std::unique_lock<std::mutex> lock(queueMutex);
+            idleProcessors.fetch_add(1);
+            cv.wait(lock, [this]() { return queuedThreads.load() > 0 || done; });
+            idleProcessors.fetch_sub(1);
+            if (queuedThreads.load() == 0 && done)
+                return false;
+        }
+    }
+};
+
+#endif // THREAD_SCHEDULER_HPP
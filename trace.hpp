@@ -0,0 +1,211 @@
+// trace.hpp
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <fstream>
+#include <string>
+#include <algorithm>
+
+// Compact binary trace events, recorded into per-thread lock-free ring buffers and drained by a
+// background thread. Call Tracer::start() to enable recording; emit() is a relaxed load and
+// returns immediately while tracing is off.
+enum class TraceEvent : uint16_t {
+    SliceBegin,     // ThreadScheduler: thread `id` starts a slice on processor `track`
+    SlicePreempt,   // ... and is preempted at the end of it
+    SliceComplete,  // ... and completes at the end of it
+    SubtaskBegin,   // DAGScheduler: subtask `id` starts on pool worker `track`
+    SubtaskEnd,
+    TaskBegin,      // MultiProcessorEnv: task `id` starts on processor `track`
+    TaskEnd,        // Tasks overlap on a processor, so they export as async spans
+    CoroutineBegin, // DAGScheduler: coroutine subtask `id` starts on pool worker `track`
+    CoroutineEnd,   // ... and returns, possibly on another worker (async span)
+};
+
+struct TraceRecord {
+    uint64_t ts;    // ns; the virtual-clock simulator records simulated time
+    TraceEvent type;
+    uint16_t track;
+    int32_t id;
+    uint32_t scope;  // Coroutine spans: the run they belong to, as concurrent runs reuse ids
+};
+
+// Single-producer (the owning thread) / single-consumer (the drainer) ring.
+class TraceBuffer {
+public:
+    static constexpr size_t Capacity = 1 << 16;
+
+    bool push(const TraceRecord& r) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == Capacity) return false;
+        records[h & (Capacity - 1)] = r;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    template <typename Out>
+    void drainInto(Out& out) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t h = head.load(std::memory_order_acquire);
+        for (; t != h; ++t) out.push_back(records[t & (Capacity - 1)]);
+        tail.store(t, std::memory_order_release);
+    }
+
+private:
+    std::unique_ptr<TraceRecord[]> records{new TraceRecord[Capacity]};
+    std::atomic<size_t> head{0};
+    std::atomic<size_t> tail{0};
+};
+
+class Tracer {
+public:
+    static bool enabled() { return active.load(std::memory_order_relaxed); }
+
+    static uint64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now() - epoch()).count();
+    }
+
+    static void emit(TraceEvent type, int track, int id, uint32_t scope = 0) {
+        if (!enabled()) return;  // Before the clock read, which is most of the cost
+        emitAt(nowNs(), type, track, id, scope);
+    }
+
+    static void emitAt(uint64_t ts, TraceEvent type, int track, int id, uint32_t scope = 0) {
+        if (!enabled()) return;
+        if (!localBuffer) localBuffer = instance().registerBuffer();
+        if (!localBuffer->push(TraceRecord{ts, type, static_cast<uint16_t>(track), id, scope}))
+            instance().dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static void start() {
+        Tracer& t = instance();
+        if (active.exchange(true)) return;
+        t.stopDrainer = false;
+        t.drainer = std::thread([&t]() {
+            while (!t.stopDrainer.load()) {
+                t.drainAll();
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+    }
+
+    // Stops recording and collects everything still buffered.
+    static void stop() {
+        Tracer& t = instance();
+        if (!active.exchange(false)) return;
+        t.stopDrainer = true;
+        t.drainer.join();
+        t.drainAll();
+    }
+
+    // A fresh scope for the coroutine spans of one DAG run.
+    static uint32_t newScope() { return nextScope.fetch_add(1, std::memory_order_relaxed); }
+
+    static uint64_t droppedEvents() { return instance().dropped.load(); }
+
+    // Chrome trace JSON (chrome://tracing, ui.perfetto.dev): one process per subsystem and one
+    // timeline row per processor or worker. Call after stop().
+    static bool writeChromeJson(const std::string& path) {
+        Tracer& t = instance();
+        std::vector<TraceRecord> events = t.collected;
+        std::stable_sort(events.begin(), events.end(),
+                         [](const TraceRecord& a, const TraceRecord& b) { return a.ts < b.ts; });
+
+        std::ofstream out(path);
+        if (!out) return false;
+
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        out << "{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"ThreadScheduler\"}},\n"
+            << "{\"ph\":\"M\",\"pid\":2,\"name\":\"process_name\",\"args\":{\"name\":\"DAGScheduler workers\"}},\n"
+            << "{\"ph\":\"M\",\"pid\":3,\"name\":\"process_name\",\"args\":{\"name\":\"Processors\"}}";
+
+        std::vector<std::pair<int, int>> tracks;
+        for (const auto& e : events) tracks.emplace_back(pidFor(e.type), e.track);
+        std::sort(tracks.begin(), tracks.end());
+        tracks.erase(std::unique(tracks.begin(), tracks.end()), tracks.end());
+        for (const auto& [pid, tid] : tracks) {
+            out << ",\n{\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << tid
+                << ",\"name\":\"thread_name\",\"args\":{\"name\":\"" << (pid == 2 ? "Worker " : "P") << tid << "\"}}";
+        }
+
+        for (const auto& e : events) {
+            const char* phase = "E";
+            const char* prefix = "";
+            switch (e.type) {
+            case TraceEvent::SliceBegin:    phase = "B"; prefix = "T"; break;
+            case TraceEvent::SlicePreempt:  prefix = "T"; break;
+            case TraceEvent::SliceComplete: prefix = "T"; break;
+            case TraceEvent::SubtaskBegin:  phase = "B"; prefix = "Subtask "; break;
+            case TraceEvent::SubtaskEnd:    prefix = "Subtask "; break;
+            case TraceEvent::TaskBegin:     phase = "b"; prefix = "Task "; break;
+            case TraceEvent::TaskEnd:       phase = "e"; prefix = "Task "; break;
+            case TraceEvent::CoroutineBegin: phase = "b"; prefix = "Subtask "; break;
+            case TraceEvent::CoroutineEnd:   phase = "e"; prefix = "Subtask "; break;
+            }
+            out << ",\n{\"ph\":\"" << phase << "\",\"pid\":" << pidFor(e.type) << ",\"tid\":" << e.track
+                << ",\"ts\":" << e.ts / 1000 << "." << (e.ts % 1000) / 100 << ",\"name\":\"" << prefix << e.id << "\"";
+            if (pidFor(e.type) == 3) out << ",\"cat\":\"task\",\"id\":" << e.id;
+            if (e.type == TraceEvent::CoroutineBegin || e.type == TraceEvent::CoroutineEnd)
+                out << ",\"cat\":\"coroutine\",\"id\":\"" << e.scope << "." << e.id << "\"";
+            if (e.type == TraceEvent::SliceComplete) out << ",\"args\":{\"completed\":true}";
+            out << "}";
+        }
+        out << "\n]}\n";
+        return static_cast<bool>(out);
+    }
+
+private:
+    static Tracer& instance() {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    static std::chrono::steady_clock::time_point epoch() {
+        static const auto start = std::chrono::steady_clock::now();
+        return start;
+    }
+
+    static int pidFor(TraceEvent type) {
+        switch (type) {
+        case TraceEvent::SubtaskBegin:
+        case TraceEvent::SubtaskEnd:
+        case TraceEvent::CoroutineBegin:
+        case TraceEvent::CoroutineEnd: return 2;
+        case TraceEvent::TaskBegin:
+        case TraceEvent::TaskEnd: return 3;
+        default: return 1;
+        }
+    }
+
+    // Buffers live as long as the process so the drainer never races a thread exiting.
+    TraceBuffer* registerBuffer() {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        buffers.push_back(std::make_unique<TraceBuffer>());
+        return buffers.back().get();
+    }
+
+    void drainAll() {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (auto& b : buffers) b->drainInto(collected);
+    }
+
+    std::mutex registryMutex;
+    std::vector<std::unique_ptr<TraceBuffer>> buffers;
+    std::vector<TraceRecord> collected;  // Only touched by the drainer, or after stop()
+    std::thread drainer;
+    std::atomic<bool> stopDrainer{false};
+    std::atomic<uint64_t> dropped{0};
+
+    inline static std::atomic<bool> active{false};
+    inline static std::atomic<uint32_t> nextScope{1};
+    inline static thread_local TraceBuffer* localBuffer = nullptr;
+};
+
+#endif // TRACE_HPP
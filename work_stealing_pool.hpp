@@ -0,0 +1,310 @@
+// work_stealing_pool.hpp
+#ifndef WORK_STEALING_POOL_HPP
+#define WORK_STEALING_POOL_HPP
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <memory>
+
+#include "inplace_function.hpp"
+#include "cpu_topology.hpp"
+
+// Fixed set of worker threads, each with its own job deque.
+// A worker pops from the back of its own deque (most recently spawned work first)
+// and, when that is empty, steals from the front of the other workers' deques.
+// Jobs are small-buffer callables in per-worker rings that only grow, so once the rings have
+// reached their working size submitting and running a job does not allocate.
+// With a WorkerAffinity each worker is pinned to a CPU and steals from its nearest workers first.
+class WorkStealingPool {
+public:
+    using Job = InplaceFunction<void()>;
+
+    // Called by a worker that found no job to run or steal, before it goes to sleep.
+    // Returns true if it found other work (typically by submitting new jobs).
+    using IdlePoll = std::function<bool(WorkStealingPool&, unsigned worker)>;
+
+    explicit WorkStealingPool(unsigned numWorkers = std::thread::hardware_concurrency(),
+                              IdlePoll idlePoll = nullptr, WorkerAffinity affinity = {})
+        : idlePoll(std::move(idlePoll)) {
+        if (numWorkers == 0) numWorkers = 1;
+        for (unsigned i = 0; i < numWorkers; ++i) {
+            workers.push_back(std::make_unique<Worker>());
+            workers[i]->cpu = i < affinity.cpus.size() ? affinity.cpus[i] : -1;
+            if (i < affinity.stealOrder.size()) {
+                workers[i]->victims = std::move(affinity.stealOrder[i]);
+            } else {
+                for (unsigned k = 1; k < numWorkers; ++k) workers[i]->victims.push_back((i + k) % numWorkers);
+            }
+        }
+        for (unsigned i = 0; i < numWorkers; ++i) {
+            threads.emplace_back([this, i]() { workerLoop(i); });
+        }
+    }
+
+    // Runs every job that is still queued, and every job announced with expectSubmission(),
+    // then joins the workers.
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMtx);
+            stopping = true;
+        }
+        sleepCv.notify_all();
+        for (auto& t : threads) {
+            if (t.joinable()) t.join();
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // Jobs submitted from one of this pool's workers go to that worker's own deque,
+    // so a finishing job hands its successors to the same (cache-warm) thread.
+    // Jobs submitted from outside are spread round robin across the workers.
+    void submit(Job job) {
+        unsigned target;
+        if (currentPool == this) {
+            target = currentIndex;
+        } else {
+            target = nextVictim.fetch_add(1, std::memory_order_relaxed) % workers.size();
+        }
+        submitTo(target, std::move(job));
+    }
+
+    // Queues the job on a specific worker's deque (it can still be stolen by idle workers).
+    // For a placement that must hold, use submitPinned().
+    void submitTo(unsigned target, Job job) {
+        target %= size();
+        {
+            std::lock_guard<std::mutex> lock(workers[target]->mtx);
+            workers[target]->jobs.push_back(std::move(job));
+        }
+        pending.fetch_add(1);
+        if (sleepers.load() > 0) {
+            std::lock_guard<std::mutex> lock(sleepMtx);
+            sleepCv.notify_one();
+        }
+    }
+
+    // Queues the job where only `target` runs it: it is never stolen, and the worker takes its
+    // pinned jobs, oldest first, before anything in its own deque.
+    void submitPinned(unsigned target, Job job) {
+        target %= size();
+        Worker& w = *workers[target];
+        {
+            std::lock_guard<std::mutex> lock(w.mtx);
+            w.pinnedJobs.push_back(std::move(job));
+        }
+        w.pinnedPending.fetch_add(1);
+        pinnedPending.fetch_add(1);
+        if (sleepers.load() > 0) {
+            std::lock_guard<std::mutex> lock(sleepMtx);
+            sleepCv.notify_all();  // The one condition variable cannot wake a particular worker
+        }
+    }
+
+    // Announces a job that will be submitted later from outside the pool, such as a coroutine
+    // resumption parked on a timer. The pool is not torn down until it has been submitted with
+    // submitExpected() or withdrawn with cancelExpected().
+    void expectSubmission() { expected.fetch_add(1); }
+
+    void submitExpected(Job job) {
+        submit(std::move(job));  // Counted in pending before it stops being expected
+        releaseExpected();
+    }
+
+    void cancelExpected() { releaseExpected(); }
+
+    // Wakes sleeping workers so they run the idle poll again, e.g. after new work was made
+    // available somewhere the poll looks. `count` > 1 wakes every sleeper.
+    void notify(unsigned count = 1) {
+        wakeEpoch.fetch_add(1);
+        if (sleepers.load() > 0) {
+            std::lock_guard<std::mutex> lock(sleepMtx);
+            if (count == 1) {
+                sleepCv.notify_one();
+            } else {
+                sleepCv.notify_all();
+            }
+        }
+    }
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+    // Per-worker counters, for throughput per core. Each worker only updates its own.
+    struct WorkerStats {
+        int cpu;                  // CPU the worker is pinned to, -1 if unpinned or pinning failed
+        unsigned long long jobs;  // Jobs run, own and stolen
+        unsigned long long steals;
+    };
+
+    WorkerStats stats(unsigned worker) const {
+        const Worker& w = *workers[worker];
+        return WorkerStats{w.pinned.load(std::memory_order_relaxed) ? w.cpu : -1,
+                           w.jobsRun.load(std::memory_order_relaxed), w.stolen.load(std::memory_order_relaxed)};
+    }
+
+    // Index of the calling worker within its pool, or -1 when called from any other thread.
+    static int currentWorker() { return currentPool ? static_cast<int>(currentIndex) : -1; }
+
+    // Pool of the calling worker, or nullptr when called from any other thread.
+    static WorkStealingPool* current() { return currentPool; }
+
+    // Process-wide pool sized to the machine, created on first use.
+    static WorkStealingPool& shared() {
+        static WorkStealingPool pool;
+        return pool;
+    }
+
+private:
+    // Double-ended ring of jobs; the capacity is a power of two and doubles when full.
+    class JobRing {
+    public:
+        bool empty() const { return count == 0; }
+
+        void push_back(Job&& job) {
+            if (count == slots.size()) grow();
+            slots[(head + count) & (slots.size() - 1)] = std::move(job);
+            ++count;
+        }
+
+        Job& back() { return slots[(head + count - 1) & (slots.size() - 1)]; }
+        Job& front() { return slots[head]; }
+
+        void pop_back() { --count; }
+
+        void pop_front() {
+            head = (head + 1) & (slots.size() - 1);
+            --count;
+        }
+
+    private:
+        void grow() {
+            std::vector<Job> bigger(slots.empty() ? 64 : slots.size() * 2);
+            for (size_t k = 0; k < count; ++k) bigger[k] = std::move(slots[(head + k) & (slots.size() - 1)]);
+            slots.swap(bigger);
+            head = 0;
+        }
+
+        std::vector<Job> slots;
+        size_t head = 0;
+        size_t count = 0;
+    };
+
+    // Cache-line aligned so one worker's counters never share a line with another's deque.
+    struct alignas(64) Worker {
+        std::mutex mtx;
+        JobRing jobs;
+        JobRing pinnedJobs;                     // Never stolen; see submitPinned()
+        std::atomic<int> pinnedPending{0};
+        int cpu = -1;
+        std::vector<unsigned> victims;  // Steal order: nearest workers first
+        std::atomic<bool> pinned{false};
+        std::atomic<unsigned long long> jobsRun{0};
+        std::atomic<unsigned long long> stolen{0};
+    };
+
+    bool popPinned(unsigned i, Job& job) {
+        Worker& w = *workers[i];
+        if (w.pinnedPending.load() == 0) return false;
+        {
+            std::lock_guard<std::mutex> lock(w.mtx);
+            job = std::move(w.pinnedJobs.front());
+            w.pinnedJobs.pop_front();
+        }
+        w.pinnedPending.fetch_sub(1);
+        // Workers held back at shutdown only by other workers' pinned jobs may exit now.
+        if (pinnedPending.fetch_sub(1) == 1 && stopping.load() && sleepers.load() > 0) {
+            std::lock_guard<std::mutex> lock(sleepMtx);
+            sleepCv.notify_all();
+        }
+        return true;
+    }
+
+    bool popLocal(unsigned i, Job& job) {
+        Worker& w = *workers[i];
+        std::lock_guard<std::mutex> lock(w.mtx);
+        if (w.jobs.empty()) return false;
+        job = std::move(w.jobs.back());
+        w.jobs.pop_back();
+        return true;
+    }
+
+    bool steal(unsigned thief, Job& job) {
+        Worker& self = *workers[thief];
+        for (unsigned v : self.victims) {
+            Worker& victim = *workers[v];
+            {
+                std::lock_guard<std::mutex> lock(victim.mtx);
+                if (victim.jobs.empty()) continue;
+                job = std::move(victim.jobs.front());
+                victim.jobs.pop_front();
+            }
+            self.stolen.store(self.stolen.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    // The last outstanding announcement lets workers held back by the destructor exit.
+    void releaseExpected() {
+        if (expected.fetch_sub(1) == 1 && sleepers.load() > 0) {
+            std::lock_guard<std::mutex> lock(sleepMtx);
+            sleepCv.notify_all();
+        }
+    }
+
+    void workerLoop(unsigned i) {
+        currentPool = this;
+        currentIndex = i;
+        Worker& self = *workers[i];
+        if (self.cpu >= 0) self.pinned.store(pinCurrentThread(self.cpu), std::memory_order_relaxed);
+
+        Job job;
+        while (true) {
+            // Read before polling so a notify() that lands after the poll still wakes us.
+            const unsigned long long seen = wakeEpoch.load();
+
+            const bool wasPinned = popPinned(i, job);
+            if (wasPinned || popLocal(i, job) || steal(i, job)) {
+                if (!wasPinned) pending.fetch_sub(1);
+                job();
+                job = nullptr;
+                self.jobsRun.store(self.jobsRun.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                continue;
+            }
+            if (idlePoll && idlePoll(*this, i)) continue;
+
+            std::unique_lock<std::mutex> lock(sleepMtx);
+            sleepers.fetch_add(1);
+            sleepCv.wait(lock, [this, &self, seen]() {
+                return pending.load() > 0 || self.pinnedPending.load() > 0 || wakeEpoch.load() != seen ||
+                       (stopping && expected.load() == 0 && pinnedPending.load() == 0);
+            });
+            sleepers.fetch_sub(1);
+            if (stopping && pending.load() == 0 && pinnedPending.load() == 0 && expected.load() == 0) return;
+        }
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    std::mutex sleepMtx;
+    std::condition_variable sleepCv;
+    std::atomic<int> pending{0};        // Stealable jobs queued
+    std::atomic<int> pinnedPending{0};  // Pinned jobs queued, over all workers
+    std::atomic<int> expected{0};       // Announced with expectSubmission(), not yet submitted
+    std::atomic<int> sleepers{0};
+    std::atomic<unsigned> nextVictim{0};
+    std::atomic<unsigned long long> wakeEpoch{0};
+    std::atomic<bool> stopping{false};  // Set under sleepMtx
+    IdlePoll idlePoll;
+
+    inline static thread_local WorkStealingPool* currentPool = nullptr;
+    inline static thread_local unsigned currentIndex = 0;
+};
+
+#endif // WORK_STEALING_POOL_HPP
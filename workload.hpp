@@ -0,0 +1,299 @@
+// workload.hpp
+#ifndef WORKLOAD_HPP
+#define WORKLOAD_HPP
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <climits>
+#include <string>
+#include <vector>
+#include <random>
+#include <stdexcept>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sched_policy.hpp"
+
+// Threads in arrival order, produced one at a time so the simulator never needs the whole
+// workload in memory.
+class ArrivalSource {
+public:
+    virtual ~ArrivalSource() = default;
+
+    // Fills t with the next arrival; false once the workload is exhausted. Arrival times
+    // never decrease.
+    virtual bool next(SimThread& t) = 0;
+};
+
+// Threads added to the scheduler up front, replayed in stable arrival order.
+class VectorArrivalSource : public ArrivalSource {
+public:
+    explicit VectorArrivalSource(std::vector<SimThread> threads) : threads(std::move(threads)) {
+        std::stable_sort(this->threads.begin(), this->threads.end(),
+                         [](const SimThread& a, const SimThread& b) { return a.arrivalTime < b.arrivalTime; });
+    }
+
+    bool next(SimThread& t) override {
+        if (pos == threads.size()) return false;
+        t = threads[pos++];
+        return true;
+    }
+
+private:
+    std::vector<SimThread> threads;
+    size_t pos = 0;
+};
+
+// Workload threads are not named: interning one string per entry of a large trace would cost
+// more than the rest of the simulation. label() prints them as T<id>.
+inline SimThread makeWorkloadThread(int id, long long arrival, int burst, int priority, int affinity) {
+    SimThread t(id, "", burst, static_cast<int>(arrival));
+    t.priority = priority;
+    t.affinity = affinity;
+    t.deadline = static_cast<int>(std::min<long long>(arrival + 2LL * burst, INT_MAX));  // As for the built-in workload
+    return t;
+}
+
+// Recorded workload, one thread per line:
+//
+//     # arrival_ms burst_ms priority [affinity]
+//     0     1200  0
+//     15    300   -5   2
+//
+// Fields are separated by spaces, tabs or commas; blank lines and lines starting with '#' are
+// skipped. priority is a nice value (-20..19) and affinity a processor index, taken modulo the
+// processor count. Arrivals must be sorted.
+//
+// Regular files are memory-mapped and parsed in place; pages already consumed are dropped
+// every few MB so a huge trace does not stay resident. Anything that cannot be mapped (a pipe,
+// /dev/stdin) is read in fixed-size chunks instead. Malformed lines throw std::runtime_error
+// naming the file and line.
+class TraceFileSource : public ArrivalSource {
+public:
+    explicit TraceFileSource(const std::string& path) : path(path) {
+        fd = path == "-" ? dup(STDIN_FILENO) : ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error(path + ": " + std::strerror(errno));
+
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                madvise(p, st.st_size, MADV_SEQUENTIAL);
+                mapped = static_cast<char*>(p);
+                mappedLength = st.st_size;
+                cur = mapped;
+                end = mapped + mappedLength;
+                eof = true;
+            }
+        }
+        if (!mapped) {
+            buffer.resize(ChunkBytes);
+            cur = end = buffer.data();
+        }
+    }
+
+    TraceFileSource(const TraceFileSource&) = delete;
+    TraceFileSource& operator=(const TraceFileSource&) = delete;
+
+    ~TraceFileSource() override {
+        if (mapped) munmap(mapped, mappedLength);
+        if (fd >= 0) ::close(fd);
+    }
+
+    bool next(SimThread& t) override {
+        const char* lineBegin;
+        const char* lineEnd;
+        while (nextLine(lineBegin, lineEnd)) {
+            ++lineNumber;
+            const char* p = lineBegin;
+            skipSeparators(p, lineEnd);
+            if (p == lineEnd || *p == '#' || *p == '\r') continue;
+
+            long long fields[4] = {0, 0, 0, -1};
+            int count = 0;
+            while (p < lineEnd && *p != '#' && *p != '\r') {
+                if (count == 4) fail("more than 4 fields");
+                fields[count++] = parseInt(p, lineEnd);
+                skipSeparators(p, lineEnd);
+            }
+            if (count < 3) fail("expected arrival_ms burst_ms priority [affinity]");
+
+            const long long arrival = fields[0], burst = fields[1], priority = fields[2], affinity = fields[3];
+            if (arrival < 0 || arrival > INT_MAX) fail("arrival out of range");
+            if (arrival < lastArrival) fail("arrivals are not sorted");
+            if (burst <= 0 || burst > INT_MAX) fail("burst must be positive");
+            if (priority < -20 || priority > 19) fail("priority must be a nice value in -20..19");
+            if (affinity < -1 || affinity > INT_MAX) fail("affinity must be a processor index");
+            lastArrival = arrival;
+
+            t = makeWorkloadThread(++nextId, arrival, static_cast<int>(burst), static_cast<int>(priority),
+                                   static_cast<int>(affinity));
+            return true;
+        }
+        return false;
+    }
+
+private:
+    static constexpr size_t ChunkBytes = 1 << 20;
+    static constexpr size_t DropBytes = 16 << 20;  // Mapped pages released per madvise()
+
+    static void skipSeparators(const char*& p, const char* e) {
+        while (p < e && (*p == ' ' || *p == '\t' || *p == ',')) ++p;
+    }
+
+    long long parseInt(const char*& p, const char* e) const {
+        bool negative = false;
+        if (p < e && (*p == '-' || *p == '+')) negative = *p++ == '-';
+        if (p == e || *p < '0' || *p > '9') fail("expected an integer");
+        long long v = 0;
+        while (p < e && *p >= '0' && *p <= '9') {
+            if (v > (LLONG_MAX - 9) / 10) fail("number too large");
+            v = v * 10 + (*p++ - '0');
+        }
+        if (p < e && *p != ' ' && *p != '\t' && *p != ',' && *p != '\r' && *p != '#') fail("expected an integer");
+        return negative ? -v : v;
+    }
+
+    [[noreturn]] void fail(const std::string& what) const {
+        throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": " + what);
+    }
+
+    // [begin, end) of the next line without its '\n'; the last line may be unterminated.
+    bool nextLine(const char*& lineBegin, const char*& lineEnd) {
+        while (true) {
+            const char* nl = static_cast<const char*>(std::memchr(cur, '\n', end - cur));
+            if (nl) {
+                lineBegin = cur;
+                lineEnd = nl;
+                cur = nl + 1;
+                releaseConsumed();
+                return true;
+            }
+            if (eof) {
+                if (cur == end) return false;
+                lineBegin = cur;
+                lineEnd = end;
+                cur = end;
+                return true;
+            }
+            refill();
+        }
+    }
+
+    // Streaming mode: keeps the partial line and appends the next chunk after it.
+    void refill() {
+        const size_t offset = cur - buffer.data();
+        const size_t partial = end - cur;
+        if (partial == buffer.size()) buffer.resize(buffer.size() * 2);  // A line longer than a chunk
+        std::memmove(buffer.data(), buffer.data() + offset, partial);
+        ssize_t n;
+        do {
+            n = ::read(fd, buffer.data() + partial, buffer.size() - partial);
+        } while (n < 0 && errno == EINTR);
+        if (n < 0) throw std::runtime_error(path + ": " + std::strerror(errno));
+        cur = buffer.data();
+        end = cur + partial + n;
+        eof = n == 0;
+    }
+
+    void releaseConsumed() {
+        if (!mapped) return;
+        const size_t consumed = cur - mapped;
+        if (consumed - released < DropBytes) return;
+        const size_t upTo = consumed & ~(static_cast<size_t>(sysconf(_SC_PAGESIZE)) - 1);
+        madvise(mapped + released, upTo - released, MADV_DONTNEED);
+        released = upTo;
+    }
+
+    std::string path;
+    int fd = -1;
+    char* mapped = nullptr;
+    size_t mappedLength = 0;
+    size_t released = 0;
+    std::vector<char> buffer;
+    const char* cur = nullptr;
+    const char* end = nullptr;
+    bool eof = false;
+
+    long long lineNumber = 0;
+    long long lastArrival = 0;
+    int nextId = 0;
+};
+
+// Seeded synthetic workload, generated lazily.
+//
+// Arrivals are a Poisson process of `arrivalRate` threads per second (all at time 0 when the
+// rate is 0). Bursts are uniform in [minBurst, maxBurst] or Pareto with scale minBurst and
+// shape paretoShape: shapes around 1-2 give the many-short, few-huge mix seen in production.
+// Pareto bursts are only capped at paretoCap when it is set (and always at INT_MAX), since a
+// cap close to minBurst piles the tail up at the cap. Samples are drawn by inverse transform from the raw mt19937_64
+// stream rather than through <random> distributions, whose output differs between standard
+// libraries, so a seed reproduces the same workload everywhere.
+struct SyntheticWorkload {
+    enum class Bursts { Uniform, Pareto };
+
+    uint64_t seed = 1;
+    long long count = 10;
+    double arrivalRate = 0.0;
+    Bursts bursts = Bursts::Uniform;
+    int minBurst = 500;
+    int maxBurst = 2500;     // Uniform only
+    int paretoCap = 0;       // 0 for none
+    double paretoShape = 1.5;
+};
+
+inline SyntheticWorkload::Bursts parseBursts(const std::string& name) {
+    if (name == "uniform") return SyntheticWorkload::Bursts::Uniform;
+    if (name == "pareto") return SyntheticWorkload::Bursts::Pareto;
+    throw std::invalid_argument("unknown burst distribution: " + name);
+}
+
+class SyntheticArrivalSource : public ArrivalSource {
+public:
+    explicit SyntheticArrivalSource(const SyntheticWorkload& config) : config(config), gen(config.seed) {
+        if (config.minBurst <= 0 || config.maxBurst < config.minBurst)
+            throw std::invalid_argument("burst range must satisfy 0 < min <= max");
+        if (config.paretoCap != 0 && config.paretoCap < config.minBurst)
+            throw std::invalid_argument("Pareto cap must be at least the minimum burst");
+        if (config.arrivalRate < 0.0 || config.paretoShape <= 0.0)
+            throw std::invalid_argument("arrival rate and Pareto shape must be positive");
+    }
+
+    bool next(SimThread& t) override {
+        if (generated == config.count) return false;
+        ++generated;
+
+        if (config.arrivalRate > 0.0) clockMs += -std::log1p(-uniform()) * 1000.0 / config.arrivalRate;
+        const long long arrival = static_cast<long long>(clockMs);
+
+        int burst;
+        if (config.bursts == SyntheticWorkload::Bursts::Pareto) {
+            const double x = config.minBurst / std::pow(1.0 - uniform(), 1.0 / config.paretoShape);
+            const double cap = config.paretoCap > 0 ? config.paretoCap : INT_MAX;
+            burst = static_cast<int>(std::min<double>(x, cap));
+        } else {
+            const double span = static_cast<double>(config.maxBurst) - config.minBurst + 1;
+            burst = config.minBurst + std::min(static_cast<int>(uniform() * span), config.maxBurst - config.minBurst);
+        }
+
+        t = makeWorkloadThread(static_cast<int>(generated), std::min<long long>(arrival, INT_MAX), burst, 0, -1);
+        return true;
+    }
+
+private:
+    // [0, 1) with 53 random bits.
+    double uniform() { return static_cast<double>(gen() >> 11) * 0x1.0p-53; }
+
+    SyntheticWorkload config;
+    std::mt19937_64 gen;
+    long long generated = 0;
+    double clockMs = 0.0;
+};
+
+#endif // WORKLOAD_HPP